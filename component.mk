@@ -11,14 +11,42 @@ COMPONENT_INCDIRS := \
 
 COMPONENT_SRCDIRS := src
 
+# Host only: receive SSDP multicast traffic on a worker thread
+COMPONENT_VARS += UPNP_THREADED_RECEIVE
+UPNP_THREADED_RECEIVE ?= 0
+ifeq ($(UPNP_THREADED_RECEIVE),1)
+ifneq ($(SMING_ARCH),Host)
+$(error UPNP_THREADED_RECEIVE is only supported for Host builds)
+endif
+endif
+COMPONENT_CXXFLAGS += -DUPNP_THREADED_RECEIVE=$(UPNP_THREADED_RECEIVE)
+
+# Record counters and timings for the main processing paths
+COMPONENT_VARS += UPNP_ENABLE_METRICS
+UPNP_ENABLE_METRICS ?= 0
+GLOBAL_CFLAGS += -DUPNP_ENABLE_METRICS=$(UPNP_ENABLE_METRICS)
+
+# Parse SOAP action requests as they arrive instead of buffering the whole body
+COMPONENT_VARS += UPNP_STREAM_SOAP_REQUESTS
+UPNP_STREAM_SOAP_REQUESTS ?= 1
+COMPONENT_CXXFLAGS += -DUPNP_STREAM_SOAP_REQUESTS=$(UPNP_STREAM_SOAP_REQUESTS)
+
+# Default limit on the size of a single action argument value
+COMPONENT_VARS += UPNP_MAX_ARG_SIZE
+UPNP_MAX_ARG_SIZE ?= 8192
+GLOBAL_CFLAGS += -DUPNP_MAX_ARG_SIZE=$(UPNP_MAX_ARG_SIZE)
+
 COMPONENT_DOXYGEN_INPUT := src/include
-COMPONENT_DOCFILES := tools/scan/README.rst
+COMPONENT_DOCFILES := \
+	tools/scan/README.rst \
+	tools/bench/README.rst
 
 # Create targets for application schema
 #
 # Tool for scanning, fetching and parsing. Needs to be pre-built
 #
 UPNP_SCAN_TOOL = $(UPNP_TOOLS)/scan/out/Host/debug/firmware/scan$(TOOL_EXT)
+UPNP_BENCH_TOOL = $(UPNP_TOOLS)/bench/out/Host/release/firmware/bench$(TOOL_EXT)
 
 .PHONY: upnp-tools
 upnp-tools: ##Build UPnP tools
@@ -32,6 +60,8 @@ $(UPNP_SCAN_TOOL):
 UPNP_SCAN = $(UPNP_SCAN_TOOL) $(HOST_NETWORK_OPTIONS) -- scan $(HOST_PARAMETERS)
 UPNP_PARSE = $(UPNP_SCAN_TOOL) --nonet -- parse $(HOST_PARAMETERS)
 UPNP_FETCH = $(UPNP_SCAN_TOOL) $(HOST_NETWORK_OPTIONS) -- fetch $(HOST_PARAMETERS)
+UPNP_BULKPARSE = $(UPNP_SCAN_TOOL) --nonet -- bulkparse $(HOST_PARAMETERS)
+UPNP_REPLAY = $(UPNP_SCAN_TOOL) $(HOST_NETWORK_OPTIONS) -- replay $(HOST_PARAMETERS)
 
 .PHONY: upnp-check-scan
 
@@ -46,3 +76,21 @@ upnp-parse: $(UPNP_SCAN_TOOL) ##Parse raw device descriptions (use HOST_PARAMETE
 .PHONY: upnp-fetch
 upnp-fetch: $(UPNP_SCAN_TOOL) ##Fetch device description by URL (use HOST_PARAMETERS)
 	$(UPNP_FETCH)
+
+.PHONY: upnp-bulkparse
+upnp-bulkparse: $(UPNP_SCAN_TOOL) ##Generate schema from directories of raw device descriptions using multiple threads (use HOST_PARAMETERS)
+	$(UPNP_BULKPARSE)
+
+.PHONY: upnp-replay
+upnp-replay: $(UPNP_SCAN_TOOL) ##Replay captured discovery against a local HTTP server to measure performance (use HOST_PARAMETERS)
+	$(UPNP_REPLAY)
+
+.PHONY: upnp-bench
+upnp-bench: ##Build and run UPnP benchmarks (use HOST_PARAMETERS)
+	$(Q) $(MAKE) -C $(UPNP_TOOLS)/bench SMING_ARCH=Host SMING_RELEASE=1
+	$(UPNP_BENCH_TOOL) --nonet -- $(HOST_PARAMETERS)
+
+.PHONY: upnp-alloc-check
+upnp-alloc-check: ##Run UPnP benchmarks and fail if heap allocations exceed budgets (use HOST_PARAMETERS)
+	$(Q) $(MAKE) -C $(UPNP_TOOLS)/bench SMING_ARCH=Host SMING_RELEASE=1
+	$(UPNP_BENCH_TOOL) --nonet -- --check-budget $(HOST_PARAMETERS)
@@ -54,6 +54,11 @@ int onHttpRequest(HttpServerConnection& connection, HttpRequest& request, HttpRe
 		return 0;
 	}
 
+	if(path == F("status.json")) {
+		response.sendDataStream(UPnP::deviceHost.generateStatus(), MIME_JSON);
+		return 0;
+	}
+
 	Serial.print("Page not found: ");
 	Serial.println(request.uri.Path);
 
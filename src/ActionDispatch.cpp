@@ -0,0 +1,110 @@
+/**
+ * ActionDispatch.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/ActionDispatch.h"
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+
+namespace
+{
+using namespace UPnP::ActionDispatch;
+
+/*
+ * Parse using 64-bit conversions and check ranges explicitly:
+ * on 32-bit targets strtol() saturates at the i4/ui4 limits, so out-of-range values would pass.
+ */
+bool checkInteger(const char* value, int32_t minValue, int32_t maxValue)
+{
+	char* end;
+	errno = 0;
+	auto n = strtoll(value, &end, 10);
+	return end != value && *end == '\0' && errno == 0 && n >= minValue && n <= maxValue;
+}
+
+bool checkUnsigned(const char* value, uint32_t maxValue)
+{
+	// strtoull() accepts leading whitespace and a minus sign, negating the result
+	if(!isdigit(*value) && *value != '+') {
+		return false;
+	}
+	char* end;
+	errno = 0;
+	auto n = strtoull(value, &end, 10);
+	return end != value && *end == '\0' && errno == 0 && n <= maxValue;
+}
+
+bool checkValue(ArgType type, const char* value)
+{
+	switch(type) {
+	case ArgType::string:
+		return true;
+	case ArgType::boolean:
+		return strcmp(value, "0") == 0 || strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 ||
+			   strcasecmp(value, "false") == 0 || strcasecmp(value, "yes") == 0 || strcasecmp(value, "no") == 0;
+	case ArgType::ui1:
+		return checkUnsigned(value, UINT8_MAX);
+	case ArgType::ui2:
+		return checkUnsigned(value, UINT16_MAX);
+	case ArgType::ui4:
+		return checkUnsigned(value, UINT32_MAX);
+	case ArgType::i1:
+		return checkInteger(value, INT8_MIN, INT8_MAX);
+	case ArgType::i2:
+		return checkInteger(value, INT16_MIN, INT16_MAX);
+	case ArgType::i4:
+		return checkInteger(value, INT32_MIN, INT32_MAX);
+	case ArgType::r4:
+	case ArgType::r8: {
+		char* end;
+		strtod(value, &end);
+		return end != value && *end == '\0';
+	}
+	default:
+		return false;
+	}
+}
+
+} // namespace
+
+namespace UPnP
+{
+namespace ActionDispatch
+{
+bool checkArgs(const ActionRequest& req, const ArgInfo* args, unsigned argCount)
+{
+	for(unsigned i = 0; i < argCount; ++i) {
+		auto& arg = args[i];
+		auto value = req.getArgValue(*arg.name);
+		if(value == nullptr) {
+			debug_w("[UPnP] Action '%s' missing argument '%s'", req.actionName().c_str(), String(*arg.name).c_str());
+			return false;
+		}
+		if(!checkValue(arg.type, value)) {
+			debug_w("[UPnP] Action '%s' argument '%s' invalid: '%s'", req.actionName().c_str(),
+					String(*arg.name).c_str(), value);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace ActionDispatch
+} // namespace UPnP
@@ -26,9 +26,8 @@ namespace UPnP
 ActionResponse::Stream::~Stream()
 {
 	debug_w("[UPnP] destroy ActionResponse::Stream");
-	if(auto response = responses.head()) {
+	for(auto response = responses.head(); response != nullptr; response = response->next()) {
 		reinterpret_cast<ActionResponse*>(response)->stream = nullptr;
-		response = response->next();
 	}
 }
 
@@ -39,6 +38,10 @@ void ActionResponse::Stream::complete(Error err)
 
 	auto& httpResponse = *connection.getResponse();
 
+#if UPNP_ENABLE_METRICS
+	String actionName = envelope->actionName();
+#endif
+
 	if(envelope->contentType() == Envelope::ContentType::fault) {
 		httpResponse.code = HTTP_STATUS_INTERNAL_SERVER_ERROR;
 	} else if(!!err) {
@@ -50,6 +53,8 @@ void ActionResponse::Stream::complete(Error err)
 		httpResponse.code = HTTP_STATUS_INTERNAL_SERVER_ERROR;
 	}
 
+	UPNP_METRIC(recordAction(envelope->service, actionName, micros() - startTime, envelope->fault().errorCode()));
+
 	envelope->serialize(*this, false);
 	done = true;
 
@@ -18,6 +18,7 @@
  ****/
 
 #include "include/Network/UPnP/BaseObject.h"
+#include "include/Network/UPnP/Metrics.h"
 #include <Network/SSDP/Server.h>
 
 namespace UPnP
@@ -26,6 +27,7 @@ void BaseObject::sendMessage(Message& msg, MessageSpec& ms)
 {
 	if(formatMessage(msg, ms)) {
 		server.sendMessage(msg);
+		UPNP_METRIC(countSsdpSent());
 	}
 }
 
@@ -42,23 +42,80 @@ int ClassGroup::List::add(const FlashString& domain, const ObjectClass::List& cl
 		}
 	}
 
-	if(Vector<ClassGroup>::add({domain, classes})) {
-		return count() - 1;
-	} else {
+	if(!Vector<ClassGroup>::add({domain, classes})) {
 		return -1;
 	}
+
+	/*
+	 * Insert after any existing entries with the same hash, so where two groups
+	 * define the same type the first one registered wins.
+	 */
+	for(unsigned i = 0; i < classes.length(); ++i) {
+		auto cls = classes.data()[i];
+		auto hash = cls->hash();
+		if(!index.insertElementAt({hash, cls}, upperBound(hash))) {
+			debug_e("[UPnP] Failed to index class group");
+			removeIndexEntries(classes, i);
+			removeElementAt(count() - 1);
+			return -1;
+		}
+	}
+
+	return count() - 1;
 }
 
-const ObjectClass* ClassGroup::List::find(const Urn& objectType) const
+void ClassGroup::List::removeIndexEntries(const ObjectClass::List& classes, unsigned classCount)
 {
-	for(unsigned i = 0; i < count(); ++i) {
-		auto& group = elementAt(i);
-		if(group.domain != objectType.domain) {
-			continue;
+	for(unsigned i = 0; i < classCount; ++i) {
+		auto cls = classes.data()[i];
+		auto hash = cls->hash();
+		for(unsigned j = lowerBound(hash); j < index.count() && index[j].hash == hash; ++j) {
+			if(index[j].cls == cls) {
+				index.removeElementAt(j);
+				break;
+			}
 		}
+	}
+}
+
+unsigned ClassGroup::List::lowerBound(uint32_t hash) const
+{
+	unsigned first{0};
+	unsigned last = index.count();
+	while(first < last) {
+		auto mid = (first + last) / 2;
+		if(index[mid].hash < hash) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	return first;
+}
+
+unsigned ClassGroup::List::upperBound(uint32_t hash) const
+{
+	unsigned first{0};
+	unsigned last = index.count();
+	while(first < last) {
+		auto mid = (first + last) / 2;
+		if(index[mid].hash <= hash) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	return first;
+}
+
+const ObjectClass* ClassGroup::List::find(const Urn& objectType) const
+{
+	auto hash = ObjectClass::hash(objectType.kind, objectType.domain, objectType.type, objectType.version);
 
-		auto cls = group.find(objectType.kind, objectType.type, objectType.version);
-		if(cls != nullptr) {
+	// Confirm match in case of hash collision
+	for(unsigned i = lowerBound(hash); i < index.count() && index[i].hash == hash; ++i) {
+		auto cls = index[i].cls;
+		if(cls->typeIs(objectType)) {
 			return cls;
 		}
 	}
@@ -174,7 +174,7 @@ void ControlPoint::onNotify(SSDP::BasicMessage& message)
 		return;
 	}
 
-	request->setResponseStream(new DescriptionParser(*this, location));
+	request->setResponseStream(new DescriptionParser(*this, location, arenaBlockSize));
 
 	request->onRequestComplete([this, uniqueServiceName](HttpConnection& connection, bool success) -> int {
 		if(!bool(activeSearch)) {
@@ -199,6 +199,7 @@ void ControlPoint::onNotify(SSDP::BasicMessage& message)
 
 		assert(response->stream != nullptr);
 		auto parser = reinterpret_cast<DescriptionParser*>(response->stream);
+		UPNP_METRIC(recordDescriptionFetch(parser->size(), micros() - parser->startTime));
 
 		switch(activeSearch->kind) {
 		case Search::Kind::device: {
@@ -30,6 +30,9 @@ size_t DescriptionParser::write(const uint8_t* data, size_t size)
 
 	auto startLen = buffer.length();
 
+	// Any objects created are allocated from our arena
+	ObjectArena::Scope arenaScope(arena);
+
 	if(!buffer.concat(reinterpret_cast<const char*>(data), size)) {
 		state = State::error;
 		return result;
@@ -99,6 +102,10 @@ size_t DescriptionParser::write(const uint8_t* data, size_t size)
 		} else if(foundTag == Tag::device) {
 			if(rootDevice == nullptr) {
 				auto dev = cls->createRootDevice();
+				if(dev == nullptr) {
+					state = State::error;
+					break;
+				}
 				if(dev->configureRoot(controlPoint, location, objectNode)) {
 					debug_i("Configured root device '%s'", dev->caption().c_str());
 					rootDevice = dev;
@@ -112,6 +119,10 @@ size_t DescriptionParser::write(const uint8_t* data, size_t size)
 				assert(device != nullptr);
 				auto parent = device;
 				device = cls->createDevice(*parent);
+				if(device == nullptr) {
+					state = State::error;
+					break;
+				}
 				if(device->configure(objectNode)) {
 					parent->addDevice(device);
 					debug_i("Configured device '%s'", device->caption().c_str());
@@ -121,6 +132,10 @@ size_t DescriptionParser::write(const uint8_t* data, size_t size)
 			}
 		} else if(device != nullptr) {
 			auto service = cls->createService(*device);
+			if(service == nullptr) {
+				state = State::error;
+				break;
+			}
 			device->addService(service);
 			service->configure(objectNode);
 			debug_i("Configured service '%s' on device '%s'", service->caption().c_str(),
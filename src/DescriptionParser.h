@@ -21,6 +21,7 @@
 
 #include <Data/Stream/ReadWriteStream.h>
 #include "include/Network/UPnP/DeviceControl.h"
+#include "include/Network/UPnP/Metrics.h"
 #include "XmlBuffer.h"
 
 namespace UPnP
@@ -30,14 +31,23 @@ class ControlPoint;
 class DescriptionParser : public ReadWriteStream
 {
 public:
-	DescriptionParser(ControlPoint& controlPoint, const String& location)
+	/**
+	 * @param arenaBlockSize If non-zero, objects are created in an ObjectArena
+	 */
+	DescriptionParser(ControlPoint& controlPoint, const String& location, size_t arenaBlockSize = 0)
 		: controlPoint(controlPoint), location(location)
 	{
+		if(arenaBlockSize != 0) {
+			arena = ObjectArena::create(arenaBlockSize);
+		}
 	}
 
 	~DescriptionParser()
 	{
 		delete rootDevice;
+		if(arena != nullptr) {
+			arena->release();
+		}
 	}
 
 	using ReadWriteStream::write;
@@ -59,11 +69,23 @@ public:
 		return 0;
 	}
 
+	/**
+	 * @brief Get total number of bytes received
+	 */
+	size_t size() const
+	{
+		return totalSize;
+	}
+
 	/**
 	 * Parser creates root device
 	 */
 	DeviceControl* rootDevice{nullptr};
 
+#if UPNP_ENABLE_METRICS
+	uint32_t startTime{micros()}; ///< When description was requested
+#endif
+
 private:
 	// Identifies which section of description is being parsed
 	enum class State {
@@ -80,6 +102,7 @@ private:
 	XmlBuffer buffer;
 	size_t totalSize{0};
 	DeviceControl* device{nullptr}; // Current device being processed
+	ObjectArena* arena{nullptr};    // Device tree allocated from here, if set
 };
 
 } // namespace UPnP
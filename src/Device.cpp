@@ -18,8 +18,10 @@
  ****/
 
 #include "include/Network/UPnP/Device.h"
+#include "include/Network/UPnP/DeviceHost.h"
 #include "include/Network/UPnP/ItemEnumerator.h"
 #include "include/Network/UPnP/DescriptionStream.h"
+#include "include/Network/UPnP/Metrics.h"
 #include <Network/SSDP/Server.h>
 #include <Network/Http/HttpConnection.h>
 #include <Network/Url.h>
@@ -158,6 +160,84 @@ String Device::getField(Field desc) const
 	}
 }
 
+void Device::enableFieldCache(bool enable)
+{
+	fieldCache_.enable(enable);
+
+	for(auto service = services_.head(); service != nullptr; service = service->getNext()) {
+		service->enableFieldCache(enable);
+	}
+
+	for(auto device = devices_.head(); device != nullptr; device = device->getNext()) {
+		device->enableFieldCache(enable);
+	}
+}
+
+String Device::getCacheValue(unsigned index) const
+{
+	if(index < unsigned(Field::MAX)) {
+		return getField(Field(index));
+	}
+
+	String usn;
+	switch(index) {
+	case cacheLocation:
+		return getUrl(getField(Field::descriptionURL));
+	case cacheRootUsn:
+		usn = getField(Field::UDN);
+		usn += "::";
+		usn += SSDP::UPNP_ROOTDEVICE;
+		return usn;
+	case cacheTypeUsn:
+		usn = getField(Field::UDN);
+		usn += "::";
+		usn += getField(Field::deviceType);
+		return usn;
+	default:
+		return nullptr;
+	}
+}
+
+void Device::updateFieldCache()
+{
+	if(fieldCache_.isEnabled()) {
+		fieldCache_.clear();
+		fieldCache_.build(
+			cacheCount, [this](unsigned index) { return getCacheValue(index); }, deviceHost.getLocalAddress());
+	}
+
+	for(auto service = services_.head(); service != nullptr; service = service->getNext()) {
+		service->updateFieldCache();
+	}
+
+	for(auto device = devices_.head(); device != nullptr; device = device->getNext()) {
+		device->updateFieldCache();
+	}
+}
+
+const char* Device::getCachedValue(unsigned index) const
+{
+	if(!fieldCache_.isEnabled()) {
+		return nullptr;
+	}
+
+	auto address = deviceHost.getLocalAddress();
+	auto value = fieldCache_.get(address, index);
+	if(value == nullptr) {
+		fieldCache_.build(
+			cacheCount, [this](unsigned index) { return getCacheValue(index); }, address);
+		value = fieldCache_.get(address, index);
+	}
+
+	return value;
+}
+
+String Device::getLocation() const
+{
+	auto location = getCachedValue(cacheLocation);
+	return location ? String(location) : getUrl(getField(Field::descriptionURL));
+}
+
 IDataSourceStream* Device::createDescription()
 {
 	return new DescriptionStream(*this, root().getField(Field::descriptionURL));
@@ -180,13 +260,12 @@ ItemEnumerator* Device::getList(unsigned index, String& name)
 	return nullptr;
 }
 
-void Device::search(const SearchFilter& filter)
+void Device::matchSearch(const SearchFilter& filter)
 {
 	switch(filter.ms.target()) {
 	case SearchTarget::root:
 		if(isRoot()) {
 			filter.callback(this, SearchMatch::root);
-			return;
 		}
 		break;
 	case SearchTarget::all:
@@ -197,18 +276,28 @@ void Device::search(const SearchFilter& filter)
 		filter.callback(this, SearchMatch::type);
 		break;
 	case SearchTarget::type:
-		if(filter.targetString == getField(Field::deviceType)) {
+		if(fieldIs(Field::deviceType, filter.targetString)) {
 			filter.callback(this, SearchMatch::type);
 		}
 		break;
 	case SearchTarget::uuid:
-		if(filter.targetString == getField(Field::UDN)) {
+		if(fieldIs(Field::UDN, filter.targetString)) {
 			filter.callback(this, SearchMatch::uuid);
 		}
 		break;
 	default:
 		assert(false);
 	}
+}
+
+void Device::search(const SearchFilter& filter)
+{
+	matchSearch(filter);
+
+	// Only root devices can match
+	if(filter.ms.target() == SearchTarget::root) {
+		return;
+	}
 
 	if(filter.ms.target() != SearchTarget::uuid) {
 		for(auto service = services_.head(); service != nullptr; service = service->getNext()) {
@@ -223,7 +312,8 @@ void Device::search(const SearchFilter& filter)
 
 String Device::getUrl(const String& path) const
 {
-	Url url(URI_SCHEME_HTTP, nullptr, nullptr, WifiStation.getIP().toString(), 80, resolvePath(path));
+	auto port = httpPort() ?: 80;
+	Url url(URI_SCHEME_HTTP, nullptr, nullptr, deviceHost.getLocalAddress().toString(), port, resolvePath(path));
 	return url.toString();
 }
 
@@ -248,9 +338,13 @@ String Device::resolvePath(const String& path) const
 
 bool Device::formatMessage(Message& msg, MessageSpec& ms)
 {
-	msg[HTTP_HEADER_LOCATION] = getUrl(getField(Field::descriptionURL));
+	if(getCachedValue(cacheLocation) != nullptr) {
+		return formatCachedMessage(msg, ms);
+	}
+
+	msg[HTTP_HEADER_LOCATION] = getLocation();
 
-	String serverId = SSDP::getServerId(getField(Field::productNameAndVersion));
+	String serverId = getField(Field::serverId);
 	if(ms.type() == MessageType::notify) {
 		msg[HTTP_HEADER_SERVER] = serverId;
 	} else {
@@ -271,7 +365,7 @@ bool Device::formatMessage(Message& msg, MessageSpec& ms)
 		usn += st;
 		break;
 	case SearchMatch::uuid:
-		st = getField(Field::UDN);
+		st = usn;
 		break;
 	default:
 		debug_e("[UPnP] Invalid search match value");
@@ -287,13 +381,59 @@ bool Device::formatMessage(Message& msg, MessageSpec& ms)
 	return true;
 }
 
-bool Device::onHttpRequest(HttpServerConnection& connection)
+/*
+ * All values are available from the cache, so assign them to headers directly
+ */
+bool Device::formatCachedMessage(Message& msg, MessageSpec& ms)
+{
+	msg[HTTP_HEADER_LOCATION] = getCachedValue(cacheLocation);
+	msg[(ms.type() == MessageType::notify) ? HTTP_HEADER_SERVER : HTTP_HEADER_USER_AGENT] =
+		getCachedField(Field::serverId);
+
+	auto& st = (msg.type == MessageType::notify) ? msg["NT"] : msg["ST"];
+	const char* usn;
+	switch(ms.match()) {
+	case SearchMatch::root:
+		st = SSDP::UPNP_ROOTDEVICE;
+		usn = getCachedValue(cacheRootUsn);
+		break;
+	case SearchMatch::type:
+		st = getCachedField(Field::deviceType);
+		usn = getCachedValue(cacheTypeUsn);
+		break;
+	case SearchMatch::uuid:
+		usn = getCachedField(Field::UDN);
+		st = usn;
+		break;
+	default:
+		debug_e("[UPnP] Invalid search match value");
+		return false;
+	}
+
+	msg["USN"] = usn;
+	return true;
+}
+
+String Device::getUrlPath(UrlType type) const
+{
+	switch(type) {
+	case UrlType::presentation:
+		return isRoot() ? Url(fieldValue(Field::presentationURL)).Path : nullptr;
+	case UrlType::description:
+		return resolvePath(fieldValue(Field::descriptionURL));
+	default:
+		return nullptr;
+	}
+}
+
+bool Device::handleUrlRequest(HttpServerConnection& connection, UrlType type)
 {
 	auto request = connection.getRequest();
+	auto response = connection.getResponse();
 
-	if(isRoot() && request->uri.Path == Url(getField(Field::presentationURL)).Path) {
+	switch(type) {
+	case UrlType::presentation: {
 		debug_i("[UPnP] Sending default presentation page for '%s'", getField(Field::type).c_str());
-		auto response = connection.getResponse();
 		auto tmpl = new FSTR::TemplateStream(upnp_default_page);
 		tmpl->onGetValue([this](const char* name) -> String {
 			Field field;
@@ -307,16 +447,30 @@ bool Device::onHttpRequest(HttpServerConnection& connection)
 		return true;
 	}
 
-	if(request->uri.Path == resolvePath(getField(Field::descriptionURL))) {
+	case UrlType::description:
 		debug_i("[UPnP] Sending '%s' for '%s' to %s:%u", request->uri.Path.c_str(), getField(Field::type).c_str(),
 				connection.getRemoteIp().toString().c_str(), connection.getRemotePort());
-		auto response = connection.getResponse();
 		if(request->method == HTTP_GET) {
+			UPNP_METRIC(countDescriptionServed());
 			sendXml(*response, createDescription());
 		} else {
 			response->code = HTTP_STATUS_BAD_REQUEST;
 		}
 		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool Device::onHttpRequest(HttpServerConnection& connection)
+{
+	auto& path = connection.getRequest()->uri.Path;
+
+	for(auto type : {UrlType::presentation, UrlType::description}) {
+		if(path == getUrlPath(type)) {
+			return handleUrlRequest(connection, type);
+		}
 	}
 
 	for(auto service = services_.head(); service != nullptr; service = service->getNext()) {
@@ -337,7 +491,7 @@ bool Device::onHttpRequest(HttpServerConnection& connection)
 void Device::sendXml(HttpResponse& response, IDataSourceStream* content)
 {
 	response.headers[F("Content-Language")] = "en";
-	response.headers[HTTP_HEADER_SERVER] = getField(Device::Field::serverId);
+	response.headers[HTTP_HEADER_SERVER] = fieldValue(Field::serverId);
 	response.headers[HTTP_HEADER_CONNECTION] = _F("close");
 	response.headers["EXT"] = "";
 	response.headers[F("X-User-Agent")] = F("Sming");
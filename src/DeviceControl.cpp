@@ -36,6 +36,9 @@ bool DeviceControl::configureRoot(ControlPoint& controlPoint, const String& loca
 		url.setLength(i);
 	}
 	rootConfig.reset(new RootConfig{controlPoint, url, path});
+	if(!rootConfig) {
+		return false;
+	}
 
 	return DeviceControl::configure(device);
 }
@@ -19,60 +19,74 @@
 
 #include "include/Network/UPnP/DeviceHost.h"
 #include "include/Network/UPnP/DescriptionStream.h"
+#include "include/Network/UPnP/StatusStream.h"
 #include <Network/SSDP/Server.h>
 #include <Platform/Station.h>
+#include <Platform/AccessPoint.h>
+#include <SystemClock.h>
 #include <Data/Stream/MemoryDataStream.h>
 #include "main.h"
+#include "SearchCursor.h"
+#include "EnvelopeParser.h"
 
 namespace UPnP
 {
 DeviceHost deviceHost;
 
 /*
- * If MX is specified, wait random time before responding.
- * This should be done by the Server to space out service responses.
- * It also allows time for previous UDP packets to be sent which helps
- * minimise transient RAM usage.
- *
- * Probably the first step is to find out how many services
- * to respond with so we can ensure all responses are sent within the
- * given time.
- *
- * Say we have 32 services (unlikely to ever be that high) with a
- * 2 second window, that gives us 62ms per response, so we'll get some
- * randomness just due to processing time.
- *
- * If there's only one service then no problem.
- *
- * Perhaps we just divide MX by the number of services and calculate a
- * random number based on that.
- *
- *
+ * Handles all requests for a server owned by DeviceHost
+ */
+class DeviceHost::ServerResource : public HttpResource
+{
+public:
+	void shutdown(HttpServerConnection& connection) override
+	{
+		// Connection closed, possibly part-way through a request
+		delete deviceHost.takeSoapParser(connection);
+	}
+};
+
+namespace
+{
+/*
  * "For multicast M-SEARCH requests, if the search request does not contain an MX header field,
  * the device shall silently discard and ignore the search request. If the MX header field specifies
  * a field value greater than 5, the device should assume that it contained the value 5 or less."
- *
- * No reason given.
+ */
+constexpr unsigned maxSearchWindowSecs{5};
+
+/*
+ * "Device and service advertisements shall be re-sent prior to expiration of the duration specified
+ * in the CACHE-CONTROL header field... it is recommended that such refreshing of advertisements be done
+ * at a randomly-distributed interval of less than one-half of the advertisement expiration time"
+ */
+constexpr unsigned minMaxAge{1800};
+// Keeps advertisement intervals within timer range
+constexpr unsigned maxMaxAge{86400};
+
+} // namespace
+
+/*
+ * Responses are spread over the MX window by the planner in `search()`.
+ * This avoids bunching up UDP sends and allows time for previous packets
+ * to be sent which helps minimise transient RAM usage.
  */
 void DeviceHost::onSearchRequest(const BasicMessage& request)
 {
-	auto mx = request["MX"];
+	checkHeap();
 
-	unsigned delay = mx ? atoi(mx) : 0;
-	if(delay == 0) {
-		delay = 5;
-	} else if(delay > 5) {
-		delay = 5;
-	}
+	auto& stats = searchLimiter_.stats;
+	++stats.received;
 
-	auto osrand = os_random();
-	delay = osrand / (std::numeric_limits<decltype(osrand)>::max() / 1000U / delay);
-	if(delay < 100) {
-		delay = 100;
+	auto mx = request["MX"];
+
+	unsigned windowSecs = mx ? atoi(mx) : 0;
+	if(windowSecs == 0 || windowSecs > maxSearchWindowSecs) {
+		windowSecs = maxSearchWindowSecs;
 	}
 
 	MessageSpec ms(MessageType::response);
-	SearchFilter filter(ms, delay);
+	SearchFilter filter(ms, 0);
 
 	filter.targetString = request["ST"];
 	if(filter.targetString == SSDP::UPNP_ROOTDEVICE) {
@@ -85,36 +99,91 @@ void DeviceHost::onSearchRequest(const BasicMessage& request)
 		ms.setTarget(SearchTarget::uuid);
 	} else {
 		debug_e("[UPnP] Invalid ST field: %s", filter.targetString.c_str());
+		++stats.invalid;
 		return;
 	}
 
 	ms.setRemote(request.remoteIP, request.remotePort);
 
-	search(filter, nullptr);
+	if(isDuplicateSearch(ms, filter.targetString)) {
+		debug_d("[UPnP] Ignoring duplicate search from %s", request.remoteIP.toString().c_str());
+		++stats.duplicates;
+		return;
+	}
+
+	if(!searchLimiter_.accept(request.remoteIP)) {
+		debug_w("[UPnP] Search rate exceeded for %s", request.remoteIP.toString().c_str());
+		++stats.rateLimited;
+		return;
+	}
+
+	UPNP_METRIC(countSearchAnswered());
+	search(filter, nullptr, windowSecs * 1000U);
 }
 
-void DeviceHost::search(SearchFilter& filter, Device* device)
+/*
+ * Matches are counted first so responses can be spread evenly across the window.
+ * Each response is given a random time within its own slot.
+ * A window of 0 sends messages at fixed intervals, as for NOTIFY.
+ *
+ * A single cursor is created for the request which queues one message at a time,
+ * locating the matching object and formatting the message only when it is sent.
+ */
+SearchCursor* DeviceHost::search(SearchFilter& filter, Device* device, uint32_t windowMs)
 {
-	filter.callback = [&](BaseObject* object, SearchMatch match) {
-		auto item = new MessageSpec(filter.ms, match, object);
-		server.messageQueue.add(item, filter.delayMs);
-		filter.delayMs += 100;
-	};
+	unsigned matchCount{0};
+	bool indexed = isIndexedSearch(filter.ms, device);
+	if(indexed) {
+		for(auto entry = targets.find(filter.targetString); entry != nullptr; entry = targets.findNext(entry)) {
+			++matchCount;
+		}
+	} else {
+		filter.callback = [&](BaseObject*, SearchMatch) { ++matchCount; };
+		if(device == nullptr) {
+			for(auto& dev : devices_) {
+				dev.search(filter);
+			}
+		} else {
+			device->search(filter);
+		}
+	}
 
-#if DEBUG_VERBOSE_LEVEL == DBG
-	unsigned initialCount = server.messageQueue.count();
-#endif
+	if(matchCount == 0) {
+		return nullptr;
+	}
 
-	if(device == nullptr) {
-		for(auto& dev : deviceHost.devices()) {
-			dev.search(filter);
+	// Notifications are sent on every interface, responses only to the requester
+	unsigned interfaceCount{1};
+	if(filter.ms.type() == MessageType::notify) {
+		interfaceCount = std::max(getInterfaceCount(), 1U);
+	}
+
+	unsigned available = (pendingMessages < maxQueuedMessages) ? maxQueuedMessages - pendingMessages : 0;
+	unsigned allowed = std::min(matchCount, available / interfaceCount);
+	if(allowed < matchCount) {
+		unsigned dropped = (matchCount - allowed) * interfaceCount;
+		debug_w("[UPnP] Message queue full, dropping %u messages", dropped);
+		if(filter.ms.type() == MessageType::response) {
+			searchLimiter_.stats.responsesDropped += dropped;
 		}
-	} else {
-		device->search(filter);
+		if(allowed == 0) {
+			return nullptr;
+		}
+		matchCount = allowed;
+	}
+
+	unsigned count = matchCount * interfaceCount;
+	auto cursor = new SearchCursor(filter.ms, filter.targetString, device, matchCount, interfaceCount,
+								   filter.delayMs, windowMs);
+	cursor->setIndexed(indexed);
+	cursors.add(cursor);
+	pendingMessages += count;
+	if(filter.ms.type() == MessageType::response) {
+		searchLimiter_.stats.responsesQueued += count;
 	}
+	cursor->queueNext();
 
 #if DEBUG_VERBOSE_LEVEL == DBG
-	unsigned count = server.messageQueue.count();
 	String s = toString(filter.ms.type());
 	if(!s) {
 		s = _F("**BAD**  ");
@@ -133,30 +202,150 @@ void DeviceHost::search(SearchFilter& filter, Device* device)
 		s += filter.targetString;
 	}
 	s += _F(", queued: ");
-	s += count - initialCount;
-	s += _F(", total: ");
 	s += count;
+	s += _F(", total: ");
+	s += pendingMessages;
 	s += "\r\n";
 
 	m_puts(s.c_str());
 #endif
+
+	return cursor;
+}
+
+void DeviceHost::onCursorMessageSent(SearchCursor& cursor)
+{
+	checkHeap();
+
+	if(pendingMessages != 0) {
+		--pendingMessages;
+	}
+
+	if(!cursor.queueNext()) {
+		removeCursor(cursor);
+	}
+}
+
+void DeviceHost::removeCursor(SearchCursor& cursor)
+{
+	// A finished cursor has nothing queued, and its final message may still be in use by the queue
+	if(cursor.remaining() != 0) {
+		pendingMessages -= std::min(pendingMessages, cursor.remaining());
+		cursor.cancel();
+	}
+	if(cursors.contains(&cursor)) {
+		cursors.remove(&cursor);
+	}
+
+	// Defer deletion until the message queue has finished with the cursor
+	System.queueCallback(
+		[](void* param) {
+			auto cursor = static_cast<SearchCursor*>(param);
+			cursor->complete();
+			delete cursor;
+		},
+		&cursor);
+}
+
+/*
+ * Control points commonly repeat a query to allow for packet loss.
+ * While responses are still being sent (i.e. within the MX window) we can ignore these.
+ */
+bool DeviceHost::isDuplicateSearch(const MessageSpec& ms, const String& targetString)
+{
+	for(auto it = cursors.head(); it != nullptr; it = it->next()) {
+		auto cursor = static_cast<SearchCursor*>(it);
+		if(cursor->remaining() != 0 && cursor->matches(ms, targetString)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void DeviceHost::cancelCursors(Device* device, bool notifyCompletion)
+{
+	auto cursor = static_cast<SearchCursor*>(cursors.head());
+	while(cursor != nullptr) {
+		auto next = cursor->getNext();
+		if(device == nullptr || cursor->device() == device) {
+			if(!notifyCompletion) {
+				cursor->onComplete(nullptr);
+			}
+			removeCursor(*cursor);
+		}
+		cursor = next;
+	}
+
+	if(notifyCompletion) {
+		return;
+	}
+
+	for(int i = pendingRemovals.count() - 1; i >= 0; --i) {
+		if(device == nullptr || pendingRemovals[i].device == device) {
+			pendingRemovals.remove(i);
+		}
+	}
+}
+
+/*
+ * Report removal unless the device has been registered again since
+ */
+void DeviceHost::completeRemoval(Device* device)
+{
+	for(unsigned i = 0; i < pendingRemovals.count(); ++i) {
+		if(pendingRemovals[i].device == device) {
+			auto callback = pendingRemovals[i].callback;
+			pendingRemovals.remove(i);
+			callback(*device);
+			return;
+		}
+	}
 }
 
 void DeviceHost::notify(Device* device, NotifySubtype subtype)
+{
+	notifyDevice(device, subtype);
+}
+
+SearchCursor* DeviceHost::notifyDevice(Device* device, NotifySubtype subtype)
 {
 	MessageSpec ms(subtype, SearchTarget::all);
 	ms.setRemote(SSDP::multicastIp, SSDP::multicastPort);
 	SearchFilter filter(ms, 500);
-	search(filter, device);
+	return search(filter, device, 0);
 }
 
 bool DeviceHost::begin()
 {
-	return UPnP::initialize();
+	if(!UPnP::initialize()) {
+		return false;
+	}
+
+	minFreeHeap_ = system_get_free_heap_size();
+
+	if(bootId_ == 0) {
+		if(SystemClock.isSet()) {
+			setBootId(SystemClock.now(eTZ_UTC));
+		} else {
+			debug_w("[UPnP] Boot ID not set and system clock invalid: multicast events disabled until setBootId()");
+		}
+	}
+
+	Interface intf;
+	for(unsigned i = 0; getInterface(i, intf); ++i) {
+		joinSsdpGroup(intf.address);
+	}
+
+	scheduleAdvertisement();
+	return true;
 }
 
 void DeviceHost::end()
 {
+	advertTimer.stop();
+	cancelCursors(nullptr);
+	leaveSsdpGroups();
 	return UPnP::finalize();
 }
 
@@ -165,51 +354,459 @@ bool DeviceHost::isActive() const
 	return SSDP::server.isActive();
 }
 
+void DeviceHost::setMaxAge(unsigned seconds)
+{
+	maxAge_ = std::min(std::max(seconds, minMaxAge), maxMaxAge);
+	if(isActive()) {
+		scheduleAdvertisement();
+	}
+}
+
+/*
+ * Each root device is re-announced in turn, so over one cycle every tree is refreshed once.
+ * The cycle takes 3/8 of max-age, and each slot is randomised by up to 1/4 either way.
+ */
+void DeviceHost::scheduleAdvertisement()
+{
+	auto count = devices_.count();
+	if(count == 0) {
+		advertTimer.stop();
+		return;
+	}
+
+	uint32_t slotMs = maxAge_ * 1000U * 3 / 8 / count;
+	uint32_t jitter = slotMs / 4;
+	uint32_t interval = slotMs - jitter;
+	if(jitter != 0) {
+		interval += os_random() % (jitter * 2);
+	}
+
+	advertTimer.initializeMs(interval, [this]() { advertise(); }).startOnce();
+}
+
+void DeviceHost::advertise()
+{
+	auto count = devices_.count();
+	if(count != 0) {
+		advertIndex %= count;
+		auto device = devices_.head();
+		for(unsigned i = 0; i < advertIndex; ++i) {
+			device = device->getNext();
+		}
+		++advertIndex;
+		notify(device, NotifySubtype::alive);
+	}
+
+	scheduleAdvertisement();
+}
+
 bool DeviceHost::registerDevice(Device* device)
 {
-	if(!devices_.add(device)) {
+	if(device == nullptr) {
 		return false;
 	}
 
+	if(devices_.contains(device)) {
+		// Already registered, don't advertise again
+		return true;
+	}
+
+	auto port = device->httpPort();
+	if(port != 0 && !addServer(port)) {
+		return false;
+	}
+
+	devices_.add(device);
+
+	// Device may be re-registered before a previous removal has completed
+	cancelCursors(device, false);
+
+	device->updateFieldCache();
+	updateIndex(device);
+
 	if(isActive()) {
-		// TODO: If device already registered we should return true but not advertise
 		notify(device, NotifySubtype::alive);
+		scheduleAdvertisement();
 	}
 
 	return true;
 }
 
-bool DeviceHost::unRegisterDevice(Device* device)
+bool DeviceHost::unRegisterDevice(Device* device, DeviceCallback callback)
 {
+	auto next = device ? device->getNext() : nullptr;
 	if(!devices_.remove(device)) {
 		// Device wasn't running
 		return false;
 	}
 
+	for(unsigned i = 0; i < statusStreams.count(); ++i) {
+		statusStreams[i]->deviceRemoved(*device, next);
+	}
+
+	unindexDevice(*device);
+	cancelCursors(device, false);
+
+	auto port = device->httpPort();
+	if(port != 0) {
+		releaseServer(port);
+	}
+
+	SearchCursor* cursor{nullptr};
 	if(isActive()) {
-		notify(device, NotifySubtype::byebye);
+		cursor = notifyDevice(device, NotifySubtype::byebye);
+		scheduleAdvertisement();
+	}
+
+	if(callback) {
+		if(cursor == nullptr) {
+			pendingRemovals.add(PendingRemoval{device, callback});
+			System.queueCallback([this, device]() { completeRemoval(device); });
+		} else {
+			cursor->onComplete(callback);
+		}
 	}
 
-	// TODO: When last notification has been sent, inform application
 	return true;
 }
 
+bool DeviceHost::addInterface(IpAddress address, IpAddress netmask)
+{
+	Interface intf{address, netmask};
+	if(interfaces.contains(intf)) {
+		return true;
+	}
+	if(!interfaces.add(intf)) {
+		return false;
+	}
+	if(isActive()) {
+		joinSsdpGroup(address);
+	}
+	return true;
+}
+
+bool DeviceHost::removeInterface(IpAddress address)
+{
+	if(ssdpGroups.removeElement(address)) {
+		SSDP::server.leaveMulticastGroup(address, SSDP::multicastIp);
+	}
+	return interfaces.removeElement(Interface{address, {}});
+}
+
+/*
+ * The SSDP server joins the multicast group on the station interface only,
+ * so join on every other interface we advertise on.
+ */
+void DeviceHost::joinSsdpGroup(IpAddress address)
+{
+	if(address == WifiStation.getIP() || ssdpGroups.contains(address)) {
+		return;
+	}
+	if(SSDP::server.joinMulticastGroup(address, SSDP::multicastIp)) {
+		ssdpGroups.add(address);
+	} else {
+		debug_w("[UPnP] SSDP join failed on %s", address.toString().c_str());
+	}
+}
+
+void DeviceHost::leaveSsdpGroups()
+{
+	for(unsigned i = 0; i < ssdpGroups.count(); ++i) {
+		SSDP::server.leaveMulticastGroup(ssdpGroups[i], SSDP::multicastIp);
+	}
+	ssdpGroups.clear();
+}
+
+void DeviceHost::selectMulticastInterface(IpAddress address)
+{
+	SSDP::server.setMulticast(uint32_t(address) != 0 ? address : WifiStation.getIP());
+}
+
+bool DeviceHost::getInterface(unsigned index, Interface& intf) const
+{
+	if(useStation && WifiStation.isEnabled()) {
+		Interface stn{WifiStation.getIP(), WifiStation.getNetworkMask()};
+		if(uint32_t(stn.address) != 0) {
+			if(index == 0) {
+				intf = stn;
+				return true;
+			}
+			--index;
+		}
+	}
+
+	if(useAccessPoint && WifiAccessPoint.isEnabled()) {
+		if(index == 0) {
+			intf = Interface{WifiAccessPoint.getIP(), WifiAccessPoint.getNetworkMask()};
+			return true;
+		}
+		--index;
+	}
+
+	if(index < interfaces.count()) {
+		intf = interfaces[index];
+		return true;
+	}
+
+	return false;
+}
+
+unsigned DeviceHost::getInterfaceCount() const
+{
+	Interface intf;
+	unsigned count{0};
+	while(getInterface(count, intf)) {
+		++count;
+	}
+	return count;
+}
+
+bool DeviceHost::findInterface(IpAddress remoteIp, Interface& intf) const
+{
+	for(unsigned i = 0; getInterface(i, intf); ++i) {
+		if(intf.contains(remoteIp)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+IpAddress DeviceHost::getLocalAddress() const
+{
+	if(uint32_t(activeAddress) != 0) {
+		return activeAddress;
+	}
+
+	Interface intf;
+	if(getInterface(0, intf)) {
+		return intf.address;
+	}
+
+	return WifiStation.getIP();
+}
+
+bool DeviceHost::addServer(uint16_t port)
+{
+	for(unsigned i = 0; i < servers.count(); ++i) {
+		auto& srv = servers[i];
+		if(srv.port == port) {
+			++srv.refCount;
+			return true;
+		}
+	}
+
+	auto server = new HttpServer;
+	if(!server->listen(port)) {
+		debug_e("[UPnP] Failed to listen on port %u", port);
+		delete server;
+		return false;
+	}
+
+	auto resource = new ServerResource;
+	resource->onRequestComplete = [this](HttpServerConnection& connection, HttpRequest&,
+										 HttpResponse& response) -> int {
+		if(!onHttpRequest(connection)) {
+			response.code = HTTP_STATUS_NOT_FOUND;
+		}
+#if UPNP_STREAM_SOAP_REQUESTS
+		// Discard any request not claimed by a service
+		delete takeSoapParser(connection);
+#endif
+		return 0;
+	};
+#if UPNP_STREAM_SOAP_REQUESTS
+	resource->onHeadersComplete = [this](HttpServerConnection& connection, HttpRequest& request,
+										 HttpResponse&) -> int {
+		beginSoapRequest(connection, request);
+		return 0;
+	};
+	resource->onBody = [this](HttpServerConnection& connection, HttpRequest&, const char* at, int length) -> int {
+		int i = findSoapRequest(connection);
+		if(i >= 0) {
+			soapRequests[i].parser->write(at, length);
+		}
+		return 0;
+	};
+#else
+	server->setBodyParser(MIME_XML, bodyToStringParser);
+#endif
+	server->paths.setDefault(resource);
+
+	debug_i("[UPnP] Listening on port %u", port);
+	return servers.add(PortServer{server, port, 1});
+}
+
+/*
+ * Action requests are parsed into an Envelope as content arrives.
+ * The parser is held against the connection until collected by the Service once the request is complete.
+ * Nothing is allocated for requests which are going to be rejected.
+ */
+void DeviceHost::beginSoapRequest(HttpServerConnection& connection, HttpRequest& request)
+{
+	delete takeSoapParser(connection);
+
+	if(request.method != HTTP_POST) {
+		return;
+	}
+
+	Interface intf;
+	if(!findInterface(connection.getRemoteIp(), intf)) {
+		return;
+	}
+
+	auto route = routes.find(request.uri.Path);
+	if(route == nullptr || Object::UrlType(route->tag) != Object::UrlType::control) {
+		return;
+	}
+
+	auto service = static_cast<Service*>(route->object);
+	soapRequests.add(SoapRequest{&connection, new EnvelopeParser(*service, maxArgSize_)});
+}
+
+int DeviceHost::findSoapRequest(const HttpServerConnection& connection) const
+{
+	for(unsigned i = 0; i < soapRequests.count(); ++i) {
+		if(soapRequests[i].connection == &connection) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+EnvelopeParser* DeviceHost::takeSoapParser(HttpServerConnection& connection)
+{
+	int i = findSoapRequest(connection);
+	if(i < 0) {
+		return nullptr;
+	}
+
+	auto parser = soapRequests[i].parser;
+	soapRequests.remove(i);
+	return parser;
+}
+
+/*
+ * Service is going away, so abandon any requests for it
+ */
+void DeviceHost::discardSoapRequests(const Service& service)
+{
+	for(int i = soapRequests.count() - 1; i >= 0; --i) {
+		auto parser = soapRequests[i].parser;
+		if(&parser->service() == &service) {
+			delete parser;
+			soapRequests.remove(i);
+		}
+	}
+}
+
+void DeviceHost::releaseServer(uint16_t port)
+{
+	for(unsigned i = 0; i < servers.count(); ++i) {
+		auto& srv = servers[i];
+		if(srv.port != port) {
+			continue;
+		}
+		if(--srv.refCount == 0) {
+			// Server deletes itself once any active connections have closed
+			srv.server->shutdown();
+			servers.remove(i);
+		}
+		return;
+	}
+}
+
 bool DeviceHost::onHttpRequest(HttpServerConnection& connection)
 {
-	// Block access from remote networks, or if connected via AP
+	checkHeap();
+
+	// Block access from remote networks
 	auto remoteIP = connection.getRemoteIp();
-	if(!WifiStation.isLocal(remoteIP)) {
+	Interface intf;
+	if(!findInterface(remoteIP, intf)) {
 		debug_w("[UPnP] Ignoring external request from %s", remoteIP.toString().c_str());
 		return false;
 	}
 
-	for(auto& device : devices_) {
-		if(device.onHttpRequest(connection)) {
-			return true;
+	auto& path = connection.getRequest()->uri.Path;
+	auto route = routes.find(path);
+	if(route == nullptr) {
+		return false;
+	}
+
+	// URLs in responses must refer to the interface the request arrived on
+	setActiveAddress(intf.address);
+	bool handled = route->object->handleUrlRequest(connection, Object::UrlType(route->tag));
+	setActiveAddress({});
+	return handled;
+}
+
+void DeviceHost::updateIndex(Device* device)
+{
+	if(device == nullptr) {
+		return;
+	}
+
+	unindexDevice(*device);
+	indexDevice(*device);
+}
+
+void DeviceHost::addRoute(Object& object, Object::UrlType type)
+{
+	String path = object.getUrlPath(type);
+	if(!path) {
+		return;
+	}
+
+	if(routes.find(path) != nullptr) {
+		debug_w("[UPnP] Duplicate URL path '%s'", path.c_str());
+		return;
+	}
+
+	routes.add(path, &object, uint8_t(type));
+}
+
+void DeviceHost::indexDevice(Device& device)
+{
+	for(unsigned i = 0; i < unsigned(Object::UrlType::MAX); ++i) {
+		addRoute(device, Object::UrlType(i));
+	}
+
+	// Search targets must match those used by Device::search() and Service::search()
+	targets.add(device.getField(Device::Field::deviceType), &device, uint8_t(SearchMatch::type));
+	targets.add(device.getField(Device::Field::UDN), &device, uint8_t(SearchMatch::uuid));
+
+	for(auto service = device.services().head(); service != nullptr; service = service->getNext()) {
+		for(unsigned i = 0; i < unsigned(Object::UrlType::MAX); ++i) {
+			addRoute(*service, Object::UrlType(i));
 		}
+		targets.add(String(service->objectType()), service, uint8_t(SearchMatch::type));
 	}
 
-	return false;
+	for(auto child = device.devices().head(); child != nullptr; child = child->getNext()) {
+		indexDevice(*child);
+	}
+}
+
+void DeviceHost::unindexDevice(Device& device)
+{
+	// Cursors may be positioned on objects from this device
+	for(auto it = cursors.head(); it != nullptr; it = it->next()) {
+		static_cast<SearchCursor*>(it)->invalidate();
+	}
+
+	routes.remove(&device);
+	targets.remove(&device);
+
+	for(auto service = device.services().head(); service != nullptr; service = service->getNext()) {
+		routes.remove(service);
+		targets.remove(service);
+		discardSoapRequests(*service);
+	}
+
+	for(auto child = device.devices().head(); child != nullptr; child = child->getNext()) {
+		unindexDevice(*child);
+	}
 }
 
 IDataSourceStream* DeviceHost::generateDebugPage(const String& title)
@@ -241,4 +838,18 @@ IDataSourceStream* DeviceHost::generateDebugPage(const String& title)
 	return mem;
 }
 
+IDataSourceStream* DeviceHost::generateStatus()
+{
+	return new StatusStream(*this);
+}
+
+#if UPNP_ENABLE_METRICS
+IDataSourceStream* DeviceHost::generateMetrics()
+{
+	auto mem = new MemoryDataStream;
+	UPnP::metrics.printTo(*mem);
+	return mem;
+}
+#endif
+
 } // namespace UPnP
@@ -0,0 +1,499 @@
+/**
+ * EnvelopeParser.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "EnvelopeParser.h"
+#include "include/Network/UPnP/Service.h"
+
+namespace UPnP
+{
+namespace
+{
+DEFINE_FSTR_LOCAL(fs_Envelope, "Envelope")
+DEFINE_FSTR_LOCAL(fs_Body, "Body")
+
+// Element and attribute names are short: anything longer is not a valid request
+constexpr size_t maxNameLength{64};
+constexpr size_t maxNamespaceLength{128};
+
+constexpr char cdataStart[]{"[CDATA["};
+constexpr char commentStart[]{"--"};
+
+struct EntityRef {
+	char name[5];
+	char value;
+};
+
+const EntityRef entityRefs[]{
+	{"lt", '<'}, {"gt", '>'}, {"amp", '&'}, {"quot", '"'}, {"apos", '\''},
+};
+
+// Element name without any namespace prefix
+const char* localName(const String& name)
+{
+	return name.c_str() + name.indexOf(':') + 1;
+}
+
+bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+} // namespace
+
+size_t EnvelopeParser::write(const char* data, size_t size)
+{
+	totalSize += size;
+
+	for(size_t i = 0; i < size && state < State::done; ++i) {
+		// Argument content is appended a run at a time
+		if(state == State::text && isCapturing()) {
+			auto end = i;
+			while(end < size && data[end] != '<' && data[end] != '&') {
+				++end;
+			}
+			if(end > i) {
+				if(!appendValue(&data[i], end - i)) {
+					break;
+				}
+				i = end;
+				if(i == size) {
+					break;
+				}
+			}
+		}
+
+		parse(data[i]);
+	}
+
+	return size;
+}
+
+void EnvelopeParser::parse(char c)
+{
+	auto appendName = [&](String& name, char c) {
+		if(name.length() >= maxNameLength) {
+			debug_e("[SOAP] Name too long");
+			setError(Error::XmlParsing);
+		} else {
+			name += c;
+		}
+	};
+
+	switch(state) {
+	case State::text:
+		if(c == '<') {
+			state = State::tagOpen;
+		} else if(isCapturing()) {
+			if(c == '&') {
+				entityLength = 0;
+				state = State::entity;
+			} else {
+				appendValue(&c, 1);
+			}
+		}
+		break;
+
+	case State::entity:
+		if(c == ';') {
+			entity[entityLength] = '\0';
+			if(decodeEntity()) {
+				state = State::text;
+			} else if(state != State::error) {
+				debug_e("[SOAP] Bad entity reference '&%s;'", entity);
+				setError(Error::XmlParsing);
+			}
+		} else if(entityLength < sizeof(entity) - 1) {
+			entity[entityLength++] = c;
+		} else {
+			setError(Error::XmlParsing);
+		}
+		break;
+
+	case State::tagOpen:
+		tagName = nullptr;
+		if(c == '/') {
+			state = State::closeTagName;
+		} else if(c == '?') {
+			matchCount = 0;
+			state = State::instruction;
+		} else if(c == '!') {
+			markup = nullptr;
+			state = State::markup;
+		} else if(isSpace(c) || c == '>') {
+			setError(Error::XmlParsing);
+		} else {
+			tagName += c;
+			state = State::tagName;
+		}
+		break;
+
+	case State::tagName:
+		if(isSpace(c)) {
+			state = State::attributes;
+		} else if(c == '/') {
+			state = State::emptyTagEnd;
+		} else if(c == '>') {
+			startElement();
+		} else {
+			appendName(tagName, c);
+		}
+		break;
+
+	case State::emptyTagEnd:
+		if(c != '>') {
+			setError(Error::XmlParsing);
+			break;
+		}
+		startElement();
+		if(state != State::error) {
+			endElement();
+		}
+		break;
+
+	case State::closeTagName:
+		if(c == '>') {
+			endElement();
+		} else if(!isSpace(c)) {
+			appendName(tagName, c);
+		}
+		break;
+
+	case State::attributes:
+		if(c == '/') {
+			state = State::emptyTagEnd;
+		} else if(c == '>') {
+			startElement();
+		} else if(!isSpace(c)) {
+			attrName = nullptr;
+			attrName += c;
+			state = State::attrName;
+		}
+		break;
+
+	case State::attrName:
+		if(c == '=') {
+			state = State::attrValueStart;
+		} else if(isSpace(c)) {
+			state = State::attrEquals;
+		} else {
+			appendName(attrName, c);
+		}
+		break;
+
+	case State::attrEquals:
+		if(c == '=') {
+			state = State::attrValueStart;
+		} else if(!isSpace(c)) {
+			setError(Error::XmlParsing);
+		}
+		break;
+
+	case State::attrValueStart:
+		if(c == '"' || c == '\'') {
+			quote = c;
+			attrValue = nullptr;
+			captureAttr = isActionNamespace();
+			state = State::attrValue;
+		} else if(!isSpace(c)) {
+			setError(Error::XmlParsing);
+		}
+		break;
+
+	case State::attrValue:
+		if(c == quote) {
+			if(captureAttr) {
+				actionNs = std::move(attrValue);
+			}
+			state = State::attributes;
+		} else if(captureAttr) {
+			if(attrValue.length() >= maxNamespaceLength) {
+				setError(Error::BadSoapNamespace);
+			} else {
+				attrValue += c;
+			}
+		}
+		break;
+
+	case State::markup: {
+		markup += c;
+		auto len = markup.length();
+		if(markup == commentStart) {
+			matchCount = 0;
+			state = State::comment;
+		} else if(markup == cdataStart) {
+			matchCount = 0;
+			state = State::cdata;
+		} else if(strncmp(markup.c_str(), commentStart, len) != 0 && strncmp(markup.c_str(), cdataStart, len) != 0) {
+			// e.g. DOCTYPE
+			state = (c == '>') ? State::text : State::declaration;
+		}
+		break;
+	}
+
+	case State::comment:
+		if(c == '-') {
+			if(matchCount < 2) {
+				++matchCount;
+			}
+		} else if(c == '>' && matchCount == 2) {
+			state = State::text;
+		} else {
+			matchCount = 0;
+		}
+		break;
+
+	case State::cdata:
+		// Look for closing ]]>, passing through any other brackets as content
+		if(c == ']') {
+			if(matchCount < 2) {
+				++matchCount;
+			} else if(isCapturing()) {
+				appendValue(&c, 1);
+			}
+		} else if(c == '>' && matchCount == 2) {
+			state = State::text;
+		} else {
+			if(isCapturing() && (matchCount == 0 || appendValue("]]", matchCount))) {
+				appendValue(&c, 1);
+			}
+			matchCount = 0;
+		}
+		break;
+
+	case State::instruction:
+		if(c == '>' && matchCount != 0) {
+			state = State::text;
+		}
+		matchCount = (c == '?');
+		break;
+
+	case State::declaration:
+		if(c == '>') {
+			state = State::text;
+		}
+		break;
+
+	case State::done:
+	case State::error:
+		break;
+	}
+}
+
+bool EnvelopeParser::isActionNamespace() const
+{
+	if(depth != 2 || skipDepth != 0) {
+		return false;
+	}
+
+	// Looking for xmlns="..." or xmlns:prefix="..." to match element prefix
+	auto colon = tagName.indexOf(':');
+	if(colon < 0) {
+		return fs_xmlns == attrName;
+	}
+	return attrName.length() == fs_xmlns.length() + 1 + colon && attrName.startsWith(fs_xmlns) &&
+		   attrName[fs_xmlns.length()] == ':' && memcmp(attrName.c_str() + fs_xmlns.length() + 1, tagName.c_str(), colon) == 0;
+}
+
+void EnvelopeParser::startElement()
+{
+	state = State::text;
+
+	if(depth == UINT8_MAX) {
+		setError(Error::XmlParsing);
+		return;
+	}
+
+	if(skipDepth != 0) {
+		++depth;
+		return;
+	}
+
+	auto name = localName(tagName);
+	switch(depth) {
+	case 0:
+		if(!fs_Envelope.equals(name)) {
+			debug_e("[SOAP] Envelope missing");
+			setError(Error::XmlParsing);
+			return;
+		}
+		break;
+
+	case 1:
+		// Ignore s:Header
+		if(fs_Body.equals(name)) {
+			haveBody = true;
+		} else {
+			skipDepth = depth + 1;
+		}
+		break;
+
+	case 2: {
+		if(haveAction) {
+			skipDepth = depth + 1;
+			break;
+		}
+		String serviceType = String(envelope->service.objectType());
+		if(actionNs != serviceType) {
+			debug_w("[SOAP] namespace attribute incorrect, expected '%s' but found '%s'", serviceType.c_str(),
+					actionNs.c_str());
+			setError(Error::BadSoapNamespace);
+			return;
+		}
+		envelope->createRequest(name);
+		haveAction = true;
+		break;
+	}
+
+	case 3:
+		argName = name;
+		value = nullptr;
+		break;
+
+	default:
+		debug_e("[SOAP] Unexpected element '%s' in argument '%s'", tagName.c_str(), argName.c_str());
+		setError(Error::ActionArgsInvalid);
+		return;
+	}
+
+	++depth;
+}
+
+void EnvelopeParser::endElement()
+{
+	state = State::text;
+
+	if(depth == 0) {
+		setError(Error::XmlParsing);
+		return;
+	}
+
+	if(skipDepth != 0) {
+		if(depth == skipDepth) {
+			skipDepth = 0;
+		}
+		--depth;
+		return;
+	}
+
+	--depth;
+	if(depth == 0) {
+		state = State::done;
+	} else if(depth == 3) {
+		if(argName != localName(tagName)) {
+			debug_e("[SOAP] Mismatched closing tag '%s'", tagName.c_str());
+			setError(Error::XmlParsing);
+			return;
+		}
+		envelope->addArg(argName, value);
+		value = nullptr;
+	}
+}
+
+bool EnvelopeParser::appendValue(const char* s, size_t len)
+{
+	if(value.length() + len > maxArgSize) {
+		debug_w("[SOAP] Argument '%s' exceeds %u bytes", argName.c_str(), unsigned(maxArgSize));
+		setError(Error::ArgumentTooLong);
+		return false;
+	}
+
+	if(!value.concat(s, len)) {
+		setError(Error::NoMemory);
+		return false;
+	}
+
+	return true;
+}
+
+bool EnvelopeParser::decodeEntity()
+{
+	if(entity[0] == '#') {
+		bool hex = (entity[1] == 'x' || entity[1] == 'X');
+		auto digits = &entity[hex ? 2 : 1];
+		char* end;
+		auto cp = strtoul(digits, &end, hex ? 16 : 10);
+		if(end == digits || *end != '\0' || cp == 0 || cp > 0x10FFFF) {
+			return false;
+		}
+
+		// Encode as UTF-8
+		char buf[4];
+		size_t len;
+		if(cp < 0x80) {
+			buf[0] = cp;
+			len = 1;
+		} else if(cp < 0x800) {
+			buf[0] = 0xC0 | (cp >> 6);
+			buf[1] = 0x80 | (cp & 0x3F);
+			len = 2;
+		} else if(cp < 0x10000) {
+			buf[0] = 0xE0 | (cp >> 12);
+			buf[1] = 0x80 | ((cp >> 6) & 0x3F);
+			buf[2] = 0x80 | (cp & 0x3F);
+			len = 3;
+		} else {
+			buf[0] = 0xF0 | (cp >> 18);
+			buf[1] = 0x80 | ((cp >> 12) & 0x3F);
+			buf[2] = 0x80 | ((cp >> 6) & 0x3F);
+			buf[3] = 0x80 | (cp & 0x3F);
+			len = 4;
+		}
+		return appendValue(buf, len);
+	}
+
+	for(auto& ref : entityRefs) {
+		if(strcmp(entity, ref.name) == 0) {
+			return appendValue(&ref.value, 1);
+		}
+	}
+
+	return false;
+}
+
+void EnvelopeParser::setError(Error err)
+{
+	lastError = err;
+	state = State::error;
+	value = nullptr;
+}
+
+Error EnvelopeParser::finish()
+{
+	if(state == State::error) {
+		return lastError;
+	}
+
+	if(totalSize == 0) {
+		debug_w("Service: Empty request body");
+		setError(Error::NoSoapBody);
+	} else if(!haveBody) {
+		debug_e("[SOAP] Body missing");
+		setError(Error::NoSoapBody);
+	} else if(!haveAction) {
+		debug_e("[UPnP] Envelope is empty");
+		setError(Error::NoSoapContent);
+	} else if(state != State::done) {
+		debug_e("[SOAP] Request incomplete");
+		setError(Error::XmlParsing);
+	}
+
+	return lastError;
+}
+
+} // namespace UPnP
@@ -0,0 +1,151 @@
+/****
+ * EnvelopeParser.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "include/Network/UPnP/Envelope.h"
+
+namespace UPnP
+{
+/**
+ * @brief Incremental parser for incoming SOAP action requests
+ *
+ * Content is tokenized as it arrives and each argument added to an Envelope
+ * once complete, so the request body is never held in memory as a whole.
+ * Only the value of the argument currently being received is buffered.
+ */
+class EnvelopeParser
+{
+public:
+	/**
+	 * @param service Service handling the request
+	 * @param maxArgSize Fail with Error::ArgumentTooLong if any argument value exceeds this length
+	 */
+	EnvelopeParser(const Service& service, size_t maxArgSize)
+		: envelope(new Envelope(service)), maxArgSize(maxArgSize)
+	{
+	}
+
+	~EnvelopeParser()
+	{
+		delete envelope;
+	}
+
+	/**
+	 * @brief Service the request is for
+	 */
+	const Service& service() const
+	{
+		return envelope->service;
+	}
+
+	/**
+	 * @brief Process the next block of content
+	 * @retval size_t Always consumes all data; once an error occurs the remainder is discarded
+	 */
+	size_t write(const char* data, size_t size);
+
+	/**
+	 * @brief Called at the end of content to check the request is complete
+	 */
+	Error finish();
+
+	Error error() const
+	{
+		return lastError;
+	}
+
+	/**
+	 * @brief Get total number of bytes received
+	 */
+	size_t size() const
+	{
+		return totalSize;
+	}
+
+	/**
+	 * @brief Take ownership of the envelope
+	 */
+	Envelope* release()
+	{
+		auto env = envelope;
+		envelope = nullptr;
+		return env;
+	}
+
+private:
+	enum class State {
+		text,
+		entity,
+		tagOpen,
+		tagName,
+		emptyTagEnd,
+		closeTagName,
+		attributes,
+		attrName,
+		attrEquals,
+		attrValueStart,
+		attrValue,
+		markup,
+		comment,
+		cdata,
+		instruction,
+		declaration,
+		done,
+		error,
+	};
+
+	// Argument values are the content of elements at the fourth level: Envelope/Body/action/argument
+	bool isCapturing() const
+	{
+		return depth == 4 && skipDepth == 0;
+	}
+
+	bool isActionNamespace() const;
+	void setError(Error err);
+	void parse(char c);
+	bool appendValue(const char* s, size_t len);
+	bool decodeEntity();
+	void startElement();
+	void endElement();
+
+	Envelope* envelope;
+	size_t maxArgSize;
+	size_t totalSize{0};
+	String tagName;   ///< Element name being received
+	String attrName;  ///< Attribute name being received
+	String attrValue; ///< Namespace attribute value for the action element
+	String actionNs;  ///< Namespace declared for the action element
+	String argName;   ///< Argument being received
+	String value;     ///< Value of argument being received
+	String markup;    ///< Start of <! declaration, to identify comments and CDATA
+	char entity[12];  ///< Character reference being decoded
+	uint8_t entityLength{0};
+	uint8_t matchCount{0}; ///< Characters matched towards end of comment, CDATA or instruction
+	char quote{'\0'};
+	uint8_t depth{0};      ///< Current element nesting level
+	uint8_t skipDepth{0};  ///< Non-zero when ignoring an element, such as s:Header
+	bool captureAttr{false};
+	bool haveBody{false};
+	bool haveAction{false};
+	State state{};
+	Error lastError{Error::Success};
+};
+
+} // namespace UPnP
@@ -51,8 +51,12 @@ ErrorCode getErrorCode(Error err)
 		return ErrorCode::OutOfMemory;
 	case Error::ActionInvalid:
 		return ErrorCode::InvalidAction;
+	case Error::ActionArgsInvalid:
+		return ErrorCode::InvalidArgs;
 	case Error::ActionNotImplemented:
 		return ErrorCode::OptionalActionNotImplemented;
+	case Error::ArgumentTooLong:
+		return ErrorCode::StringArgumentTooLong;
 	default:
 		return ErrorCode::ActionFailed;
 	}
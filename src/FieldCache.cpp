@@ -0,0 +1,89 @@
+/**
+ * FieldCache.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/FieldCache.h"
+#include <memory>
+
+namespace UPnP
+{
+bool FieldCache::build(unsigned count, GetValue getValue, IpAddress address)
+{
+	for(unsigned i = 0; i < entries.count(); ++i) {
+		if(entries[i].address == address) {
+			entries.remove(i);
+			break;
+		}
+	}
+
+	if(this->count != count) {
+		clear();
+		this->count = count;
+	}
+
+	std::unique_ptr<String[]> values(new String[count]);
+	if(!values) {
+		return false;
+	}
+
+	size_t length = count * sizeof(uint16_t);
+	for(unsigned i = 0; i < count; ++i) {
+		values[i] = getValue(i);
+		length += values[i].length() + 1;
+	}
+
+	Entry entry{address};
+	if(length > 0xffff || !entry.data.setLength(length)) {
+		debug_e("[UPnP] Field cache allocation failed");
+		return false;
+	}
+
+	auto buf = entry.data.begin();
+	auto offsets = reinterpret_cast<uint16_t*>(buf);
+	size_t offset = count * sizeof(uint16_t);
+	for(unsigned i = 0; i < count; ++i) {
+		auto& value = values[i];
+		offsets[i] = offset;
+		memcpy(buf + offset, value.c_str(), value.length() + 1);
+		offset += value.length() + 1;
+	}
+
+	if(entries.count() >= maxEntries) {
+		entries.remove(0);
+	}
+	return entries.add(entry);
+}
+
+const char* FieldCache::get(IpAddress address, unsigned index) const
+{
+	if(index >= count) {
+		return nullptr;
+	}
+
+	for(unsigned i = 0; i < entries.count(); ++i) {
+		auto& entry = entries[i];
+		if(entry.address == address) {
+			auto buf = entry.data.c_str();
+			return buf + reinterpret_cast<const uint16_t*>(buf)[index];
+		}
+	}
+
+	return nullptr;
+}
+
+} // namespace UPnP
@@ -0,0 +1,203 @@
+/**
+ * InternedString.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/InternedString.h"
+#include "include/Network/UPnP/ObjectIndex.h"
+#include <memory>
+#include <cstddef>
+
+namespace
+{
+constexpr unsigned initialBucketCount{16};
+constexpr unsigned maxLoadFactor{2};
+
+} // namespace
+
+namespace UPnP
+{
+struct InternedString::Entry {
+	Entry* next;
+	uint32_t hash;
+	unsigned refCount;
+	uint16_t length;
+	char value[1];
+};
+
+namespace
+{
+/*
+ * Unique values are kept in a chained hash table.
+ * Entries are removed when their last reference is released.
+ */
+class StringTable
+{
+public:
+	using Entry = InternedString::Entry;
+
+	Entry* intern(const char* value, size_t length);
+	void remove(Entry* entry);
+
+	InternedString::Stats stats() const;
+
+private:
+	void grow();
+
+	std::unique_ptr<Entry*[]> buckets;
+	unsigned bucketCount{0};
+	unsigned entryCount{0};
+};
+
+StringTable table;
+
+InternedString::Entry* StringTable::intern(const char* value, size_t length)
+{
+	if(length > UINT16_MAX) {
+		return nullptr;
+	}
+
+	auto h = ObjectIndex::hash(value, length);
+	if(entryCount != 0) {
+		for(auto entry = buckets[h % bucketCount]; entry != nullptr; entry = entry->next) {
+			if(entry->hash == h && entry->length == length && memcmp(entry->value, value, length) == 0) {
+				++entry->refCount;
+				return entry;
+			}
+		}
+	}
+
+	if(entryCount >= bucketCount * maxLoadFactor) {
+		grow();
+	}
+
+	auto entry = static_cast<Entry*>(malloc(offsetof(Entry, value) + length + 1));
+	if(entry == nullptr) {
+		return nullptr;
+	}
+	entry->hash = h;
+	entry->refCount = 1;
+	entry->length = length;
+	memcpy(entry->value, value, length);
+	entry->value[length] = '\0';
+
+	auto& bucket = buckets[h % bucketCount];
+	entry->next = bucket;
+	bucket = entry;
+	++entryCount;
+	return entry;
+}
+
+void StringTable::remove(Entry* entry)
+{
+	auto prev = &buckets[entry->hash % bucketCount];
+	while(*prev != nullptr) {
+		if(*prev == entry) {
+			*prev = entry->next;
+			free(entry);
+			--entryCount;
+			return;
+		}
+		prev = &(*prev)->next;
+	}
+}
+
+void StringTable::grow()
+{
+	unsigned newCount = bucketCount ? bucketCount * 2 : initialBucketCount;
+	std::unique_ptr<Entry*[]> newBuckets(new Entry*[newCount]{});
+
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		auto entry = buckets[i];
+		while(entry != nullptr) {
+			auto next = entry->next;
+			auto& bucket = newBuckets[entry->hash % newCount];
+			entry->next = bucket;
+			bucket = entry;
+			entry = next;
+		}
+	}
+
+	buckets = std::move(newBuckets);
+	bucketCount = newCount;
+}
+
+InternedString::Stats StringTable::stats() const
+{
+	InternedString::Stats stats{};
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		for(auto entry = buckets[i]; entry != nullptr; entry = entry->next) {
+			++stats.count;
+			stats.references += entry->refCount;
+			stats.size += entry->length + 1;
+		}
+	}
+	return stats;
+}
+
+} // namespace
+
+InternedString& InternedString::operator=(const String& value)
+{
+	release();
+	if(value) {
+		entry = table.intern(value.c_str(), value.length());
+	}
+	return *this;
+}
+
+InternedString& InternedString::operator=(const InternedString& other)
+{
+	if(entry != other.entry) {
+		release();
+		entry = other.entry;
+		addRef();
+	}
+	return *this;
+}
+
+const char* InternedString::c_str() const
+{
+	return entry ? entry->value : "";
+}
+
+size_t InternedString::length() const
+{
+	return entry ? entry->length : 0;
+}
+
+void InternedString::addRef()
+{
+	if(entry != nullptr) {
+		++entry->refCount;
+	}
+}
+
+void InternedString::release()
+{
+	if(entry != nullptr && --entry->refCount == 0) {
+		table.remove(entry);
+	}
+	entry = nullptr;
+}
+
+InternedString::Stats InternedString::stats()
+{
+	return table.stats();
+}
+
+} // namespace UPnP
@@ -27,48 +27,65 @@ bool LinkedItemList::add(LinkedItem* item)
 		return false;
 	}
 
-	LinkedItem* prev = nullptr;
-	auto it = head_;
-	while(it != nullptr) {
-		if(it == item) {
-			// Already in list
-			return true;
-		}
-		prev = it;
-		it = it->next_;
+	if(item->list_ == this) {
+		return true;
+	}
+
+	if(item->list_ != nullptr) {
+		item->list_->remove(item);
 	}
 
-	if(prev == nullptr) {
+	item->prev_ = tail_;
+	item->next_ = nullptr;
+	item->list_ = this;
+	if(tail_ == nullptr) {
 		head_ = item;
 	} else {
-		prev->next_ = item;
+		tail_->next_ = item;
 	}
-	item->next_ = it;
+	tail_ = item;
+	++count_;
 	return true;
 }
 
 bool LinkedItemList::remove(LinkedItem* item)
 {
-	if(item == nullptr) {
+	if(!contains(item)) {
 		return false;
 	}
 
-	if(head_ == item) {
+	if(item->prev_ == nullptr) {
 		head_ = item->next_;
-		return true;
+	} else {
+		item->prev_->next_ = item->next_;
 	}
 
-	auto it = head_;
-	while(it->next_ != nullptr) {
-		if(it->next_ == item) {
-			it->next_ = item->next_;
-			item->next_ = nullptr;
-			return true;
-		}
-		it = it->next_;
+	if(item->next_ == nullptr) {
+		tail_ = item->prev_;
+	} else {
+		item->next_->prev_ = item->prev_;
+	}
+
+	item->next_ = nullptr;
+	item->prev_ = nullptr;
+	item->list_ = nullptr;
+	--count_;
+	return true;
+}
+
+void LinkedItemList::clear()
+{
+	auto item = head_;
+	while(item != nullptr) {
+		auto next = item->next_;
+		item->next_ = nullptr;
+		item->prev_ = nullptr;
+		item->list_ = nullptr;
+		item = next;
 	}
 
-	return false;
+	head_ = tail_ = nullptr;
+	count_ = 0;
 }
 
 } // namespace UPnP
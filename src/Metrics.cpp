@@ -0,0 +1,183 @@
+/**
+ * Metrics.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/Metrics.h"
+#include "include/Network/UPnP/Service.h"
+
+#if UPNP_ENABLE_METRICS
+
+namespace UPnP
+{
+Metrics metrics;
+
+void Metrics::Histogram::add(uint32_t value)
+{
+	if(count == 0 || value < min) {
+		min = value;
+	}
+	if(value > max) {
+		max = value;
+	}
+	++count;
+	total += value;
+
+	unsigned bucket = (value == 0) ? 0 : 32 - __builtin_clz(value);
+	++buckets[std::min(bucket, bucketCount - 1)];
+}
+
+size_t Metrics::Histogram::printTo(Print& p) const
+{
+	size_t n{0};
+	n += p.print(_F("{\"count\":"));
+	n += p.print(count);
+	n += p.print(_F(",\"min\":"));
+	n += p.print(min);
+	n += p.print(_F(",\"max\":"));
+	n += p.print(max);
+	n += p.print(_F(",\"avg\":"));
+	n += p.print(average());
+	n += p.print(_F(",\"buckets\":["));
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		if(i != 0) {
+			n += p.print(',');
+		}
+		n += p.print(buckets[i]);
+	}
+	n += p.print(_F("]}"));
+	return n;
+}
+
+void Metrics::reset()
+{
+	ssdpReceived = 0;
+	ssdpSent = 0;
+	searchesAnswered = 0;
+	descriptionsServed = 0;
+	fetchBytes = 0;
+	fetchLatency = Histogram{};
+	minFreeHeap = system_get_free_heap_size();
+	startTime = millis();
+	actions_.clear();
+}
+
+void Metrics::checkHeap()
+{
+	auto freeHeap = system_get_free_heap_size();
+	if(freeHeap < minFreeHeap) {
+		minFreeHeap = freeHeap;
+	}
+}
+
+void Metrics::recordDescriptionFetch(size_t size, uint32_t latency)
+{
+	fetchBytes += size;
+	fetchLatency.add(latency);
+	checkHeap();
+}
+
+/*
+ * Action names come from the client, so only those the service recognised get their own entry.
+ * Anything rejected as unknown is recorded under an unnamed entry for the service class.
+ */
+void Metrics::recordAction(const Service& service, const String& actionName, uint32_t latency, ErrorCode fault)
+{
+	checkHeap();
+
+	auto cls = &service.getClass();
+	bool known = fault != ErrorCode::InvalidAction && fault != ErrorCode::OptionalActionNotImplemented;
+
+	Action* action{nullptr};
+	for(unsigned i = 0; i < actions_.count(); ++i) {
+		auto& a = actions_[i];
+		if(a.cls == cls && (known ? a.name == actionName : !a.name)) {
+			action = &a;
+			break;
+		}
+	}
+
+	if(action == nullptr) {
+		if(actions_.count() >= maxActions) {
+			return;
+		}
+		actions_.add(Action{cls, known ? actionName : nullptr, {}, 0, ErrorCode::None});
+		action = &actions_[actions_.count() - 1];
+	}
+
+	action->latency.add(latency);
+	if(fault != ErrorCode::None) {
+		++action->faultCount;
+		action->lastFault = fault;
+	}
+}
+
+size_t Metrics::printTo(Print& p) const
+{
+	size_t n{0};
+	n += p.print(_F("{\"enabled\":"));
+	n += p.print(_F("true,\"elapsed\":"));
+	n += p.print(millis() - startTime);
+	n += p.print(_F(",\"ssdp\":{\"received\":"));
+	n += p.print(ssdpReceived);
+	n += p.print(_F(",\"sent\":"));
+	n += p.print(ssdpSent);
+	n += p.print(_F(",\"searchesAnswered\":"));
+	n += p.print(searchesAnswered);
+	n += p.print(_F("},\"descriptions\":{\"served\":"));
+	n += p.print(descriptionsServed);
+	n += p.print(_F(",\"fetched\":"));
+	n += p.print(fetchLatency.count);
+	n += p.print(_F(",\"fetchBytes\":"));
+	n += p.print(fetchBytes);
+	n += p.print(_F(",\"fetchLatency\":"));
+	n += fetchLatency.printTo(p);
+	n += p.print(_F("},\"actions\":["));
+	for(unsigned i = 0; i < actions_.count(); ++i) {
+		auto& action = actions_[i];
+		if(i != 0) {
+			n += p.print(',');
+		}
+		n += p.print(_F("{\"service\":\""));
+		n += p.print(toString(action.cls->objectType()));
+		n += p.print(_F("\",\"action\":"));
+		if(action.name) {
+			n += p.print('"');
+			n += p.print(action.name);
+			n += p.print('"');
+		} else {
+			n += p.print(_F("\"unknown\""));
+		}
+		n += p.print(_F(",\"faults\":"));
+		n += p.print(action.faultCount);
+		n += p.print(_F(",\"lastFault\":"));
+		n += p.print(int(action.lastFault));
+		n += p.print(_F(",\"latency\":"));
+		n += action.latency.printTo(p);
+		n += p.print('}');
+	}
+	n += p.print(_F("],\"heap\":{\"free\":"));
+	n += p.print(system_get_free_heap_size());
+	n += p.print(_F(",\"minFree\":"));
+	n += p.print(minFreeHeap);
+	n += p.print(_F("}}"));
+	return n;
+}
+
+} // namespace UPnP
+
+#endif // UPNP_ENABLE_METRICS
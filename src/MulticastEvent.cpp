@@ -0,0 +1,366 @@
+/**
+ * MulticastEvent.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/MulticastEvent.h"
+#include "include/Network/UPnP/DeviceControl.h"
+#include "include/Network/UPnP/DeviceHost.h"
+#include <FlashString/Vector.hpp>
+
+namespace
+{
+DEFINE_FSTR_LOCAL(event_namespace, "urn:schemas-upnp-org:event-1-0")
+DEFINE_FSTR_LOCAL(e_propertyset, "e:propertyset")
+DEFINE_FSTR_LOCAL(e_property, "e:property")
+DEFINE_FSTR_LOCAL(xmlns_e, "xmlns:e")
+DEFINE_FSTR_LOCAL(upnp_event, "upnp:event")
+DEFINE_FSTR_LOCAL(upnp_propchange, "upnp:propchange")
+DEFINE_FSTR_LOCAL(level_prefix, "upnp:/")
+
+#define XX(name) DEFINE_FSTR_LOCAL(lvl_##name, #name)
+UPNP_EVENT_LEVEL_MAP(XX)
+#undef XX
+
+#define XX(name) &lvl_##name,
+DEFINE_FSTR_VECTOR(levelNames, FlashString, UPNP_EVENT_LEVEL_MAP(XX))
+#undef XX
+
+/*
+ * Locate a header value within the raw message text.
+ * Returns value with leading whitespace removed, or nullptr if not found.
+ */
+String getHeader(const String& headers, const String& name)
+{
+	int pos = 0;
+	while(pos >= 0 && unsigned(pos) < headers.length()) {
+		int eol = headers.indexOf('\n', pos);
+		String line = headers.substring(pos, (eol < 0) ? headers.length() : eol);
+		pos = (eol < 0) ? -1 : eol + 1;
+
+		int sep = line.indexOf(':');
+		if(sep <= 0) {
+			continue;
+		}
+		if(!line.substring(0, sep).equalsIgnoreCase(name)) {
+			continue;
+		}
+		String value = line.substring(sep + 1);
+		value.trim();
+		return value;
+	}
+
+	return nullptr;
+}
+
+} // namespace
+
+namespace UPnP
+{
+namespace MulticastEvent
+{
+const IpAddress multicastIp(239, 255, 255, 246);
+
+Server server;
+
+/* PropertySet */
+
+PropertySet::PropertySet()
+{
+	root = XML::appendNode(&doc, e_propertyset);
+	XML::appendAttribute(root, xmlns_e, event_namespace);
+}
+
+bool PropertySet::load(String&& content)
+{
+	doc.clear();
+	root = nullptr;
+	buffer = std::move(content);
+	if(!XML::deserialize(doc, buffer)) {
+		debug_e("[UPnP] Error deserializing event");
+		return false;
+	}
+
+	root = XML::getNode(doc, F("propertyset"), event_namespace);
+	if(root == nullptr) {
+		debug_e("[UPnP] Event propertyset missing");
+		return false;
+	}
+
+	return true;
+}
+
+void PropertySet::add(const String& name, const String& value)
+{
+	auto prop = XML::appendNode(root, e_property);
+	XML::appendNode(prop, name, value);
+}
+
+XML::Node* PropertySet::getProperty(unsigned index) const
+{
+	if(root == nullptr) {
+		return nullptr;
+	}
+
+	for(auto prop = root->first_node(); prop != nullptr; prop = prop->next_sibling()) {
+		auto node = prop->first_node();
+		if(node == nullptr) {
+			continue;
+		}
+		if(index == 0) {
+			return node;
+		}
+		--index;
+	}
+
+	return nullptr;
+}
+
+const char* PropertySet::getValue(const String& name) const
+{
+	XML::Node* node;
+	for(unsigned i = 0; (node = getProperty(i)) != nullptr; ++i) {
+		if(name.equals(node->name(), node->name_size())) {
+			return node->value();
+		}
+	}
+
+	return nullptr;
+}
+
+/* Server */
+
+Server::Server()
+	: UdpConnection([this](UdpConnection&, char* data, int size, IpAddress remoteIP, uint16_t remotePort) {
+		  onReceive(data, size, remoteIP, remotePort);
+	  })
+{
+}
+
+bool Server::begin()
+{
+	if(active) {
+		return true;
+	}
+
+	DeviceHost::Interface intf;
+	for(unsigned i = 0; deviceHost.getInterface(i, intf); ++i) {
+		if(joinMulticastGroup(intf.address, multicastIp)) {
+			groups.add(intf.address);
+		} else {
+			debug_w("[UPnP] Multicast event join failed on %s", intf.address.toString().c_str());
+		}
+	}
+
+	if(groups.isEmpty()) {
+		debug_w("[UPnP] Multicast event join failed");
+		return false;
+	}
+
+	if(!listen(multicastPort)) {
+		debug_e("[UPnP] Multicast event listen failed");
+		leaveGroups();
+		return false;
+	}
+
+	active = true;
+	return true;
+}
+
+void Server::leaveGroups()
+{
+	for(unsigned i = 0; i < groups.count(); ++i) {
+		leaveMulticastGroup(groups[i], multicastIp);
+	}
+	groups.clear();
+}
+
+void Server::end()
+{
+	if(!active) {
+		return;
+	}
+
+	leaveGroups();
+	close();
+	active = false;
+}
+
+bool Server::publish(const Service& service, uint32_t seq, const PropertySet& properties, Level level)
+{
+	// Control points use BOOTID to detect restarts, so a made-up value is worse than none
+	if(deviceHost.bootId() == 0) {
+		debug_e("[UPnP] Multicast event not sent: call deviceHost.setBootId() or set the system clock");
+		return false;
+	}
+
+	if(!begin()) {
+		return false;
+	}
+
+	String body = properties.serialize();
+
+	String usn = service.device().fieldValue(Device::Field::UDN);
+	usn += "::";
+	usn += String(service.objectType());
+
+	String s;
+	s += F("NOTIFY * HTTP/1.1\r\n"
+		   "HOST: 239.255.255.246:7900\r\n"
+		   "CONTENT-TYPE: text/xml; charset=\"utf-8\"\r\n");
+	s += F("USN: ");
+	s += usn;
+	s += F("\r\nSVCID: ");
+	s += service.serviceId();
+	s += F("\r\nNT: ");
+	s += upnp_event;
+	s += F("\r\nNTS: ");
+	s += upnp_propchange;
+	s += F("\r\nSEQ: ");
+	s += seq;
+	s += F("\r\nBOOTID.UPNP.ORG: ");
+	s += deviceHost.bootId();
+	s += F("\r\nLVL: ");
+	s += level_prefix;
+	s += toString(level);
+	s += F("\r\nCONTENT-LENGTH: ");
+	s += body.length();
+	s += F("\r\n\r\n");
+	s += body;
+
+	debug_d("[UPnP] Multicast event for '%s', %u bytes", usn.c_str(), s.length());
+
+	bool sent{false};
+	for(unsigned i = 0; i < groups.count(); ++i) {
+		setMulticast(groups[i]);
+		sent |= sendStringTo(multicastIp, multicastPort, s);
+	}
+	return sent;
+}
+
+int Server::findListener(ServiceControl& service) const
+{
+	for(unsigned i = 0; i < listeners.count(); ++i) {
+		if(listeners[i].service == &service) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool Server::addListener(ServiceControl& service, Callback callback)
+{
+	int i = findListener(service);
+	if(i >= 0) {
+		listeners[i].callback = callback;
+		return true;
+	}
+
+	if(!begin()) {
+		return false;
+	}
+
+	return listeners.add({&service, callback});
+}
+
+bool Server::removeListener(ServiceControl& service)
+{
+	int i = findListener(service);
+	if(i < 0) {
+		return false;
+	}
+
+	listeners.remove(i);
+	return true;
+}
+
+void Server::onReceive(char* data, int size, IpAddress remoteIP, uint16_t remotePort)
+{
+	if(listeners.count() == 0) {
+		return;
+	}
+
+	String msg(data, size);
+	int bodyPos = msg.indexOf(F("\r\n\r\n"));
+	if(bodyPos < 0) {
+		debug_w("[UPnP] Bad multicast event from %s", remoteIP.toString().c_str());
+		return;
+	}
+
+	String headers = msg.substring(0, bodyPos);
+	if(getHeader(headers, F("NT")) != upnp_event || getHeader(headers, F("NTS")) != upnp_propchange) {
+		return;
+	}
+
+	String usn = getHeader(headers, F("USN"));
+	String svcid = getHeader(headers, F("SVCID"));
+
+	Event event{};
+	event.seq = getHeader(headers, F("SEQ")).toInt();
+	String lvl = getHeader(headers, F("LVL"));
+	if(lvl.startsWith(level_prefix)) {
+		fromString(lvl.c_str() + level_prefix.length(), event.level);
+	} else {
+		event.level = Level::general;
+	}
+
+	bool loaded{false};
+	for(unsigned i = 0; i < listeners.count(); ++i) {
+		auto& listener = listeners[i];
+		auto& service = *listener.service;
+		if(svcid != service.serviceId()) {
+			continue;
+		}
+
+		String expectedUsn = service.device().udn();
+		expectedUsn += "::";
+		expectedUsn += String(service.objectType());
+		if(usn != expectedUsn) {
+			continue;
+		}
+
+		if(!loaded) {
+			if(!event.properties.load(msg.substring(bodyPos + 4))) {
+				return;
+			}
+			loaded = true;
+		}
+
+		debug_d("[UPnP] Multicast event from %s:%u for '%s'", remoteIP.toString().c_str(), remotePort, usn.c_str());
+		listener.callback(service, event);
+	}
+}
+
+} // namespace MulticastEvent
+
+} // namespace UPnP
+
+String toString(UPnP::MulticastEvent::Level level)
+{
+	return levelNames[unsigned(level)];
+}
+
+bool fromString(const char* value, UPnP::MulticastEvent::Level& level)
+{
+	int i = levelNames.indexOf(value);
+	if(i < 0) {
+		return false;
+	}
+
+	level = UPnP::MulticastEvent::Level(i);
+	return true;
+}
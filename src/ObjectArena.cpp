@@ -0,0 +1,156 @@
+/**
+ * ObjectArena.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/ObjectArena.h"
+#include <cstdlib>
+#include <algorithm>
+#include <assert.h>
+
+namespace
+{
+/*
+ * Each allocation is preceded by a header identifying the owning arena, or nullptr for heap allocations.
+ * Sizes are rounded up so that everything stays suitably aligned.
+ */
+constexpr size_t alignment{alignof(std::max_align_t)};
+
+constexpr size_t align(size_t size)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+struct Header {
+	UPnP::ObjectArena* arena;
+};
+
+constexpr size_t headerSize{align(sizeof(Header))};
+
+} // namespace
+
+namespace UPnP
+{
+ObjectArena* ObjectArena::current;
+
+ObjectArena* ObjectArena::create(size_t blockSize)
+{
+	return new ObjectArena(blockSize);
+}
+
+ObjectArena::~ObjectArena()
+{
+	while(blocks != nullptr) {
+		auto next = blocks->next;
+		::free(blocks);
+		blocks = next;
+	}
+}
+
+void ObjectArena::release()
+{
+	unref();
+}
+
+void ObjectArena::unref()
+{
+	assert(refCount != 0);
+	if(--refCount == 0) {
+		delete this;
+	}
+}
+
+void* ObjectArena::alloc(size_t size)
+{
+	constexpr size_t blockHeaderSize{align(sizeof(Block))};
+
+	if(blocks == nullptr || blocks->size - blocks->used < size) {
+		// Oversized requests get their own block
+		auto dataSize = std::max(size, blockSize);
+		auto block = static_cast<Block*>(malloc(blockHeaderSize + dataSize));
+		if(block == nullptr) {
+			return nullptr;
+		}
+		block->size = dataSize;
+		block->used = 0;
+		block->next = blocks;
+		blocks = block;
+	}
+
+	auto ptr = reinterpret_cast<uint8_t*>(blocks) + blockHeaderSize + blocks->used;
+	blocks->used += size;
+	++refCount;
+	return ptr;
+}
+
+void* ObjectArena::allocate(size_t size)
+{
+	size = headerSize + align(size);
+	auto header = static_cast<Header*>(current ? current->alloc(size) : malloc(size));
+	if(header == nullptr) {
+		return nullptr;
+	}
+	header->arena = current;
+	return reinterpret_cast<uint8_t*>(header) + headerSize;
+}
+
+void ObjectArena::free(void* ptr)
+{
+	if(ptr == nullptr) {
+		return;
+	}
+
+	auto header = reinterpret_cast<Header*>(static_cast<uint8_t*>(ptr) - headerSize);
+	if(header->arena == nullptr) {
+		::free(header);
+	} else {
+		header->arena->unref();
+	}
+}
+
+size_t ObjectArena::capacity() const
+{
+	size_t size{0};
+	for(auto block = blocks; block != nullptr; block = block->next) {
+		size += block->size;
+	}
+	return size;
+}
+
+size_t ObjectArena::used() const
+{
+	size_t size{0};
+	for(auto block = blocks; block != nullptr; block = block->next) {
+		size += block->used;
+	}
+	return size;
+}
+
+ArenaString& ArenaString::operator=(const String& s)
+{
+	ObjectArena::free(value);
+	value = nullptr;
+	if(s) {
+		value = static_cast<char*>(ObjectArena::allocate(s.length() + 1));
+		if(value != nullptr) {
+			memcpy(value, s.c_str(), s.length() + 1);
+		}
+	}
+	return *this;
+}
+
+} // namespace UPnP
@@ -19,6 +19,7 @@
 
 #include "include/Network/UPnP/ObjectClass.h"
 #include "include/Network/UPnP/Object.h"
+#include "include/Network/UPnP/ObjectIndex.h"
 
 namespace UPnP
 {
@@ -27,6 +28,21 @@ Urn ObjectClass::objectType() const
 	return Urn(kind(), nullptr, domain(), type(), version());
 }
 
+uint32_t ObjectClass::hash() const
+{
+	return hash(kind(), domain(), type(), version());
+}
+
+uint32_t ObjectClass::hash(Kind kind, const String& domain, const String& type, Version version)
+{
+	// Combine FNV-1a hashes of the strings with the numeric values
+	uint32_t h = ObjectIndex::hash(domain.c_str(), domain.length());
+	h = (h * 31) ^ ObjectIndex::hash(type.c_str(), type.length());
+	h = (h * 31) ^ unsigned(kind);
+	h = (h * 31) ^ version;
+	return h;
+}
+
 bool ObjectClass::operator==(const ObjectClass& other) const
 {
 	if(this == &other) {
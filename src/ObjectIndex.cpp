@@ -0,0 +1,156 @@
+/**
+ * ObjectIndex.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/ObjectIndex.h"
+
+namespace
+{
+constexpr unsigned initialBucketCount{16};
+constexpr unsigned maxLoadFactor{2};
+
+} // namespace
+
+namespace UPnP
+{
+uint32_t ObjectIndex::hash(const char* key, size_t length)
+{
+	// FNV-1a
+	uint32_t h{2166136261U};
+	for(size_t i = 0; i < length; ++i) {
+		h ^= uint8_t(key[i]);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+bool ObjectIndex::add(const String& key, Object* object, uint8_t tag)
+{
+	if(!key) {
+		return false;
+	}
+
+	if(entryCount >= bucketCount * maxLoadFactor) {
+		grow();
+	}
+
+	auto h = hash(key.c_str(), key.length());
+	auto entry = new Entry{nullptr, object, h, tag, key};
+	auto& bucket = buckets[h % bucketCount];
+
+	// Append so entries for the same key are returned in the order they were added
+	auto prev = &bucket;
+	while(*prev != nullptr) {
+		prev = &(*prev)->next;
+	}
+	*prev = entry;
+	++entryCount;
+	return true;
+}
+
+const ObjectIndex::Entry* ObjectIndex::find(const char* key, size_t length) const
+{
+	if(entryCount == 0) {
+		return nullptr;
+	}
+
+	auto h = hash(key, length);
+	for(auto entry = buckets[h % bucketCount]; entry != nullptr; entry = entry->next) {
+		if(entry->hash == h && entry->key.equals(key, length)) {
+			return entry;
+		}
+	}
+
+	return nullptr;
+}
+
+const ObjectIndex::Entry* ObjectIndex::findNext(const Entry* entry) const
+{
+	if(entry == nullptr) {
+		return nullptr;
+	}
+
+	for(auto it = entry->next; it != nullptr; it = it->next) {
+		if(it->hash == entry->hash && it->key == entry->key) {
+			return it;
+		}
+	}
+
+	return nullptr;
+}
+
+unsigned ObjectIndex::remove(const Object* object)
+{
+	unsigned removed{0};
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		auto prev = &buckets[i];
+		while(*prev != nullptr) {
+			auto entry = *prev;
+			if(entry->object == object) {
+				*prev = entry->next;
+				delete entry;
+				++removed;
+			} else {
+				prev = &entry->next;
+			}
+		}
+	}
+
+	entryCount -= removed;
+	return removed;
+}
+
+void ObjectIndex::clear()
+{
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		auto entry = buckets[i];
+		while(entry != nullptr) {
+			auto next = entry->next;
+			delete entry;
+			entry = next;
+		}
+		buckets[i] = nullptr;
+	}
+	entryCount = 0;
+}
+
+void ObjectIndex::grow()
+{
+	unsigned newCount = bucketCount ? bucketCount * 2 : initialBucketCount;
+	std::unique_ptr<Entry*[]> newBuckets(new Entry*[newCount]{});
+
+	// Re-link entries, preserving relative order within each chain
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		auto entry = buckets[i];
+		while(entry != nullptr) {
+			auto next = entry->next;
+			entry->next = nullptr;
+			auto prev = &newBuckets[entry->hash % newCount];
+			while(*prev != nullptr) {
+				prev = &(*prev)->next;
+			}
+			*prev = entry;
+			entry = next;
+		}
+	}
+
+	buckets = std::move(newBuckets);
+	bucketCount = newCount;
+}
+
+} // namespace UPnP
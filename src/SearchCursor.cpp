@@ -0,0 +1,242 @@
+/**
+ * SearchCursor.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "SearchCursor.h"
+#include "include/Network/UPnP/DeviceHost.h"
+#include <Network/SSDP/Server.h>
+
+namespace
+{
+// Spacing between messages when no window is specified, e.g. NOTIFY
+constexpr unsigned fixedIntervalMs{100};
+
+} // namespace
+
+namespace UPnP
+{
+SearchCursor::SearchCursor(const MessageSpec& ms, const String& targetString, Device* device, unsigned matchCount,
+						   unsigned interfaceCount, uint32_t startMs, uint32_t windowMs)
+	: spec(ms), targetString(targetString), device_(device), matchCount(matchCount),
+	  count(matchCount * interfaceCount), startMs(startMs)
+{
+	jitter = (windowMs != 0);
+	slotMs = jitter ? windowMs / count : fixedIntervalMs;
+}
+
+uint32_t SearchCursor::getOffset(unsigned index) const
+{
+	uint32_t offset = startMs + index * slotMs;
+	if(jitter && slotMs != 0) {
+		offset += os_random() % slotMs;
+	}
+	return offset;
+}
+
+bool SearchCursor::queueNext()
+{
+	if(index >= count) {
+		return false;
+	}
+
+	// Each offset lies within its own slot so is never less than the previous one
+	auto offset = getOffset(index);
+	auto ms = new MessageSpec(spec, SearchMatch{}, this);
+	server.messageQueue.add(ms, offset - lastOffset);
+	lastOffset = offset;
+	return true;
+}
+
+void SearchCursor::cancel()
+{
+	server.messageQueue.remove(this);
+	index = count;
+}
+
+/*
+ * Matches are visited in the same order as a full search, from the search index or by walking the device tree.
+ * Messages cycle through the matches once for each interface, so normally this just steps to the next one.
+ * The walk restarts for each interface, and if objects have been added or removed since the last message,
+ * in which case fewer messages may be sent.
+ */
+BaseObject* SearchCursor::find(unsigned position, SearchMatch& match)
+{
+	if(position == 0 || position != walkPosition || invalid) {
+		invalid = false;
+		walkPosition = 0;
+		started = false;
+		entry = nullptr;
+		walkDevice = nullptr;
+		walkService = nullptr;
+		objectMatchCount = objectMatchIndex = 0;
+		while(walkPosition < position) {
+			if(step(match) == nullptr) {
+				return nullptr;
+			}
+		}
+	}
+
+	return step(match);
+}
+
+BaseObject* SearchCursor::step(SearchMatch& match)
+{
+	if(indexed) {
+		auto& targets = deviceHost.targets;
+		if(!started) {
+			entry = targets.find(targetString);
+			started = true;
+		} else if(entry != nullptr) {
+			entry = targets.findNext(entry);
+		}
+		if(entry == nullptr) {
+			return nullptr;
+		}
+		match = SearchMatch(entry->tag);
+		++walkPosition;
+		return entry->object;
+	}
+
+	while(objectMatchIndex >= objectMatchCount) {
+		if(!nextObject()) {
+			return nullptr;
+		}
+		getObjectMatches();
+	}
+
+	match = objectMatches[objectMatchIndex++];
+	++walkPosition;
+	if(walkService != nullptr) {
+		return walkService;
+	}
+	return walkDevice;
+}
+
+/*
+ * Move to next object in tree order: device, its services, then its embedded devices
+ */
+bool SearchCursor::nextObject()
+{
+	if(!started) {
+		started = true;
+		walkDevice = device_ ?: deviceHost.devices().head();
+		return walkDevice != nullptr;
+	}
+
+	if(walkDevice == nullptr) {
+		return false;
+	}
+
+	auto target = spec.target();
+
+	// Services aren't identified by UUID
+	if(target != SearchTarget::root && target != SearchTarget::uuid) {
+		walkService = (walkService == nullptr) ? walkDevice->services().head() : walkService->getNext();
+		if(walkService != nullptr) {
+			return true;
+		}
+	}
+	walkService = nullptr;
+
+	// Only root devices match a root search
+	if(target != SearchTarget::root) {
+		auto child = walkDevice->devices().head();
+		if(child != nullptr) {
+			walkDevice = child;
+			return true;
+		}
+	}
+
+	// Next sibling, or back up the tree, without leaving the device being searched
+	for(auto dev = walkDevice; dev != device_; dev = &dev->parent()) {
+		auto next = dev->getNext();
+		if(next != nullptr) {
+			walkDevice = next;
+			return true;
+		}
+		if(dev->isRoot()) {
+			break;
+		}
+	}
+
+	walkDevice = nullptr;
+	return false;
+}
+
+void SearchCursor::getObjectMatches()
+{
+	objectMatchCount = objectMatchIndex = 0;
+
+	SearchFilter filter(spec, 0);
+	filter.targetString = targetString;
+	filter.callback = [this](BaseObject*, SearchMatch m) {
+		if(objectMatchCount < ARRAY_SIZE(objectMatches)) {
+			objectMatches[objectMatchCount++] = m;
+		}
+	};
+
+	if(walkService != nullptr) {
+		walkService->search(filter);
+	} else {
+		walkDevice->matchSearch(filter);
+	}
+}
+
+/*
+ * Notifications are sent out of each interface in turn, with the appropriate LOCATION.
+ * Search responses use the interface on the same network as the requester.
+ */
+IpAddress SearchCursor::getLocalAddress(unsigned interfaceIndex) const
+{
+	DeviceHost::Interface intf;
+	bool found = (spec.type() == MessageType::notify) ? deviceHost.getInterface(interfaceIndex, intf)
+													  : deviceHost.findInterface(spec.remoteIp(), intf);
+	return found ? intf.address : IpAddress{};
+}
+
+void SearchCursor::sendMessage(Message& msg, MessageSpec& ms)
+{
+	SearchMatch match;
+	auto object = find(index % matchCount, match);
+	auto address = getLocalAddress(index / matchCount);
+	++index;
+
+	if(object != nullptr) {
+		if(ms.type() != MessageType::notify || ms.notifySubtype() == NotifySubtype::alive) {
+			String maxAge = F("max-age=");
+			maxAge += deviceHost.maxAge();
+			msg[HTTP_HEADER_CACHE_CONTROL] = maxAge;
+		}
+		ms.setMatch(match);
+		// Notifications must leave via the interface whose address is in LOCATION
+		bool notify = ms.type() == MessageType::notify;
+		if(notify) {
+			deviceHost.selectMulticastInterface(address);
+		}
+		deviceHost.setActiveAddress(address);
+		object->sendMessage(msg, ms);
+		deviceHost.setActiveAddress({});
+		if(notify) {
+			deviceHost.selectMulticastInterface({});
+		}
+	}
+
+	deviceHost.onCursorMessageSent(*this);
+}
+
+} // namespace UPnP
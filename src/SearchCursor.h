@@ -0,0 +1,161 @@
+/****
+ * SearchCursor.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "include/Network/UPnP/Device.h"
+#include "include/Network/UPnP/ObjectIndex.h"
+
+namespace UPnP
+{
+/**
+ * @brief Sends the messages for a single search request or notification
+ *
+ * Rather than queuing a MessageSpec for every matching object, a cursor queues one
+ * message at a time and locates the next matching object when it is sent.
+ * This keeps RAM usage flat regardless of the number of devices and services.
+ */
+class SearchCursor : public BaseObject
+{
+public:
+	using Callback = Delegate<void(Device& device)>;
+
+	/**
+	 * @param ms Template for messages
+	 * @param targetString Search target from request
+	 * @param device Device to search, nullptr for all registered devices
+	 * @param matchCount Number of matching objects
+	 * @param interfaceCount Number of interfaces to send messages on
+	 * @param startMs Delay before first message
+	 * @param windowMs Spread messages randomly over this period, 0 for fixed intervals
+	 */
+	SearchCursor(const MessageSpec& ms, const String& targetString, Device* device, unsigned matchCount,
+				 unsigned interfaceCount, uint32_t startMs, uint32_t windowMs);
+
+	/**
+	 * @brief Queue the next message
+	 * @retval bool false if there are no more messages to send
+	 */
+	bool queueNext();
+
+	/**
+	 * @brief Remove any queued message
+	 */
+	void cancel();
+
+	/**
+	 * @brief Set callback to be invoked when cursor has finished with the device
+	 */
+	void onComplete(Callback callback)
+	{
+		completeCallback = callback;
+	}
+
+	/**
+	 * @brief Called by DeviceHost when cursor is about to be destroyed
+	 */
+	void complete()
+	{
+		if(completeCallback && device_ != nullptr) {
+			completeCallback(*device_);
+		}
+	}
+
+	bool formatMessage(Message& msg, MessageSpec& ms) override
+	{
+		// Messages are formatted by the matching object
+		return false;
+	}
+
+	void sendMessage(Message& msg, MessageSpec& ms) override;
+
+	/**
+	 * @brief Determine if this cursor is answering the given query
+	 */
+	bool matches(const MessageSpec& ms, const String& targetString) const
+	{
+		return spec.type() == ms.type() && spec.remoteIp() == ms.remoteIp() && spec.remotePort() == ms.remotePort() &&
+			   this->targetString == targetString;
+	}
+
+	/**
+	 * @brief Locate matches using the DeviceHost search target index instead of walking the device tree
+	 */
+	void setIndexed(bool state)
+	{
+		indexed = state;
+	}
+
+	Device* device() const
+	{
+		return device_;
+	}
+
+	/**
+	 * @brief Called when objects are added or removed so the next message restarts the walk
+	 */
+	void invalidate()
+	{
+		invalid = true;
+	}
+
+	unsigned remaining() const
+	{
+		return count - index;
+	}
+
+	SearchCursor* getNext() const
+	{
+		return reinterpret_cast<SearchCursor*>(LinkedItem::next());
+	}
+
+private:
+	BaseObject* find(unsigned position, SearchMatch& match);
+	BaseObject* step(SearchMatch& match);
+	bool nextObject();
+	void getObjectMatches();
+	uint32_t getOffset(unsigned index) const;
+	IpAddress getLocalAddress(unsigned interfaceIndex) const;
+
+	MessageSpec spec;
+	String targetString;
+	Device* device_;
+	Callback completeCallback;
+	uint16_t matchCount;
+	uint16_t count;
+	uint16_t index{0};
+	uint32_t startMs;
+	uint32_t slotMs;
+	uint32_t lastOffset{0};
+	bool jitter;
+	bool indexed{false};
+
+	// Position of walk through matching objects
+	unsigned walkPosition{0};                 ///< Number of matches visited
+	bool started{false};                      ///< Walk has begun
+	bool invalid{false};                      ///< Objects have changed, walk must restart
+	const ObjectIndex::Entry* entry{nullptr}; ///< Current entry for indexed searches
+	Device* walkDevice{nullptr};              ///< Current device
+	Service* walkService{nullptr};            ///< Current service, nullptr if at device
+	SearchMatch objectMatches[3];             ///< Matches for current object
+	uint8_t objectMatchCount{0};
+	uint8_t objectMatchIndex{0};
+};
+
+} // namespace UPnP
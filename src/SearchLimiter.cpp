@@ -0,0 +1,92 @@
+/**
+ * SearchLimiter.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/SearchLimiter.h"
+
+namespace
+{
+constexpr uint32_t tokenScale{1000};
+
+} // namespace
+
+namespace UPnP
+{
+void SearchLimiter::refill(Source& src, uint32_t now)
+{
+	// One token per query, refilled at queriesPerMinute
+	uint32_t capacity = burst * tokenScale;
+	uint32_t elapsed = now - src.lastTime;
+	uint64_t refill = uint64_t(elapsed) * queriesPerMinute * tokenScale / 60000U;
+	src.tokens = std::min(uint64_t(capacity), src.tokens + refill);
+	src.lastTime = now;
+}
+
+bool SearchLimiter::take(Source& src)
+{
+	if(src.tokens < tokenScale) {
+		return false;
+	}
+
+	src.tokens -= tokenScale;
+	return true;
+}
+
+bool SearchLimiter::accept(IpAddress source)
+{
+	if(queriesPerMinute == 0) {
+		return true;
+	}
+
+	auto now = millis();
+	uint32_t ip = source;
+	uint32_t capacity = burst * tokenScale;
+
+	// Find existing entry, or a free or fully refilled one to replace
+	Source* free{nullptr};
+	for(auto& s : sources) {
+		if(s.ip == ip) {
+			refill(s, now);
+			return take(s);
+		}
+		if(free != nullptr) {
+			continue;
+		}
+		if(s.ip == 0) {
+			free = &s;
+		} else {
+			refill(s, now);
+			if(s.tokens >= capacity) {
+				free = &s;
+			}
+		}
+	}
+
+	if(free == nullptr) {
+		++stats.untracked;
+		refill(fallback, now);
+		return take(fallback);
+	}
+
+	free->ip = ip;
+	free->lastTime = now;
+	free->tokens = capacity;
+	return take(*free);
+}
+
+} // namespace UPnP
@@ -18,12 +18,15 @@
  ****/
 
 #include "include/Network/UPnP/Device.h"
+#include "include/Network/UPnP/DeviceHost.h"
 #include "include/Network/UPnP/ItemEnumerator.h"
 #include "include/Network/UPnP/DescriptionStream.h"
 #include <FlashString/Stream.hpp>
 #include <FlashString/Vector.hpp>
 #include <RapidXML.h>
 #include <Network/SSDP/Uuid.h>
+#include "EnvelopeParser.h"
+#include <memory>
 
 namespace
 {
@@ -121,6 +124,58 @@ String Service::getField(Field desc) const
 	}
 }
 
+String Service::getCacheValue(unsigned index) const
+{
+	if(index < unsigned(Field::MAX)) {
+		return getField(Field(index));
+	}
+
+	switch(index) {
+	case cacheLocation:
+		return device_.getUrl(getField(Field::SCPDURL));
+	case cacheUsn: {
+		String usn = device_.getField(Device::Field::UDN);
+		usn += "::";
+		usn += getField(Field::serviceType);
+		return usn;
+	}
+	default:
+		return nullptr;
+	}
+}
+
+void Service::updateFieldCache()
+{
+	if(fieldCache_.isEnabled()) {
+		fieldCache_.clear();
+		fieldCache_.build(
+			cacheCount, [this](unsigned index) { return getCacheValue(index); }, deviceHost.getLocalAddress());
+	}
+}
+
+const char* Service::getCachedValue(unsigned index) const
+{
+	if(!fieldCache_.isEnabled()) {
+		return nullptr;
+	}
+
+	auto address = deviceHost.getLocalAddress();
+	auto value = fieldCache_.get(address, index);
+	if(value == nullptr) {
+		fieldCache_.build(
+			cacheCount, [this](unsigned index) { return getCacheValue(index); }, address);
+		value = fieldCache_.get(address, index);
+	}
+
+	return value;
+}
+
+String Service::getLocation() const
+{
+	auto location = getCachedValue(cacheLocation);
+	return location ? String(location) : device_.getUrl(getField(Field::SCPDURL));
+}
+
 void Service::search(const SearchFilter& filter)
 {
 	switch(filter.ms.target()) {
@@ -144,24 +199,71 @@ bool Service::formatMessage(Message& msg, MessageSpec& ms)
 		return false;
 	}
 
+	auto& nt = (msg.type == MessageType::notify) ? msg["NT"] : msg["ST"];
+
+	// Assign cached values to headers directly
+	auto usn = getCachedValue(cacheUsn);
+	auto serverId = device_.getCachedField(Device::Field::serverId);
+	if(usn != nullptr && serverId != nullptr) {
+		nt = getCachedField(Field::serviceType);
+		msg["USN"] = usn;
+		msg[HTTP_HEADER_SERVER] = serverId;
+		msg[HTTP_HEADER_LOCATION] = getCachedValue(cacheLocation);
+		return true;
+	}
+
+	String st = getField(Field::serviceType);
+	String s = device_.getField(Device::Field::UDN);
+	s += "::";
+	s += st;
+	nt = st;
+	msg["USN"] = s;
 	msg[HTTP_HEADER_SERVER] = device_.getField(Device::Field::serverId);
-	msg[HTTP_HEADER_LOCATION] = device().getUrl(getField(Field::SCPDURL));
+	msg[HTTP_HEADER_LOCATION] = getLocation();
+	return true;
+}
 
-	String st = String(objectType());
-	String usn = device_.getField(Device::Field::UDN);
-	usn += "::";
-	usn += st;
+bool Service::isMulticastVariable(const String& name) const
+{
+	auto info = getClass().service();
+	if(info == nullptr || info->multicastVariables == nullptr) {
+		return false;
+	}
+
+	return info->multicastVariables->indexOf(name) >= 0;
+}
 
-	if(msg.type == MessageType::notify) {
-		msg["NT"] = st;
-	} else {
-		msg["ST"] = st;
+bool Service::sendMulticastEvent(const MulticastEvent::PropertySet& properties, MulticastEvent::Level level)
+{
+	if(!UPNP_VERSION_IS(2.0)) {
+		debug_w("[UPnP] Multicast events require UPnP 2.0");
+		return false;
 	}
-	msg["USN"] = usn;
-	return true;
+
+	if(properties.isEmpty()) {
+		return false;
+	}
+
+#ifndef NDEBUG
+	XML::Node* node;
+	for(unsigned i = 0; (node = properties.getProperty(i)) != nullptr; ++i) {
+		String name(node->name(), node->name_size());
+		if(!isMulticastVariable(name)) {
+			debug_w("[UPnP] '%s' is not a multicast variable", name.c_str());
+		}
+	}
+#endif
+
+	// Sequence number starts at 1 and skips 0 on wrap
+	++eventSeq_;
+	if(eventSeq_ == 0) {
+		eventSeq_ = 1;
+	}
+
+	return MulticastEvent::server.publish(*this, eventSeq_, properties, level);
 }
 
-bool Service::onHttpRequest(HttpServerConnection& connection)
+bool Service::handleUrlRequest(HttpServerConnection& connection, UrlType type)
 {
 	auto& request = *connection.getRequest();
 	auto& response = *connection.getResponse();
@@ -184,16 +286,38 @@ bool Service::onHttpRequest(HttpServerConnection& connection)
 	};
 
 	auto handleControl = [&]() {
-		String req = request.getBody();
+#if UPNP_ENABLE_METRICS
+		auto startTime = micros();
+#endif
+		Envelope* env{nullptr};
+		Error err{};
+#if UPNP_STREAM_SOAP_REQUESTS
+		// Request was parsed as it arrived, if received via a DeviceHost server
+		std::unique_ptr<EnvelopeParser> parser(deviceHost.takeSoapParser(connection));
+		if(parser) {
+			err = parser->finish();
+			env = parser->release();
+			debug_d("[SOAP] Request '%s', %u bytes", env->actionName().c_str(), unsigned(parser->size()));
+		}
+#endif
+
+		// Application server, body buffered by its parser
+		if(env == nullptr) {
+			String req = request.getBody();
 
 #if DEBUG_VERBOSE_LEVEL >= DBG
-		m_puts(req.c_str());
-		m_puts("\r\n");
+			m_puts(req.c_str());
+			m_puts("\r\n");
 #endif
 
-		auto env = new Envelope(*this);
-		auto err = env->load(std::move(req));
+			env = new Envelope(*this);
+			err = env->load(std::move(req));
+		}
+
 		auto stream = new ActionResponse::Stream(connection, env);
+#if UPNP_ENABLE_METRICS
+		stream->startTime = startTime;
+#endif
 		device_.sendXml(response, stream);
 
 		ActionRequest request(*env, stream);
@@ -206,28 +330,79 @@ bool Service::onHttpRequest(HttpServerConnection& connection)
 		}
 	};
 
+	/*
+	 * Subscriptions are tracked so their count is accurate, but events are not yet sent.
+	 * See UPnP Device Architecture 2.0, section 4.1.
+	 */
 	auto handleSubscribe = [&]() {
-		Uuid uuid;
-		uuid.generate();
+		expireSubscriptions();
+
+		const auto& headers = request.headers;
+		String sid;
+		int index{-1};
+		if(headers.contains(F("SID"))) {
+			sid = headers[F("SID")];
+			index = subscriptions_.indexOf(Subscription{sid, 0});
+		}
+
+		if(request.method == HTTP_UNSUBSCRIBE) {
+			if(index < 0) {
+				response.code = HTTP_STATUS_PRECONDITION_FAILED;
+				return;
+			}
+			subscriptions_.removeElementAt(index);
+			response.code = HTTP_STATUS_OK;
+			return;
+		}
+
+		if(sid) {
+			// Renewal
+			if(headers.contains(F("NT")) || headers.contains(F("CALLBACK"))) {
+				response.code = HTTP_STATUS_BAD_REQUEST;
+				return;
+			}
+			if(index < 0) {
+				response.code = HTTP_STATUS_PRECONDITION_FAILED;
+				return;
+			}
+		} else {
+			if(!headers.contains(F("CALLBACK")) || headers[F("NT")] != F("upnp:event")) {
+				response.code = HTTP_STATUS_PRECONDITION_FAILED;
+				return;
+			}
+			Uuid uuid;
+			uuid.generate();
+			sid = F("uuid:");
+			sid += String(uuid);
+			if(subscriptions_.count() >= maxSubscriptions || !subscriptions_.add(Subscription{sid, 0})) {
+				response.code = HTTP_STATUS_SERVICE_UNAVAILABLE;
+				return;
+			}
+			index = subscriptions_.count() - 1;
+		}
+
+		auto timeout = getSubscriptionTimeout(headers.contains(F("TIMEOUT")) ? headers[F("TIMEOUT")] : nullptr);
+		subscriptions_[index].expiry = millis() + timeout * 1000U;
 
-		response.headers[HTTP_HEADER_SERVER] = device_.getField(Device::Field::serverId);
-		response.headers["SID"] = String("uuid:") + String(uuid);
+		response.headers[HTTP_HEADER_SERVER] = device_.fieldValue(Device::Field::serverId);
+		response.headers["SID"] = sid;
 		response.headers[HTTP_HEADER_CONTENT_LENGTH] = "0";
-		response.headers["TIMEOUT"] = "1800";
+		response.headers["TIMEOUT"] = String(F("Second-")) + timeout;
 		response.code = HTTP_STATUS_OK;
 	};
 
-	if(uri.Path == device().resolvePath(getField(Field::SCPDURL))) {
+	switch(type) {
+	case UrlType::description:
 		printRequest();
 		if(request.method == HTTP_GET) {
+			UPNP_METRIC(countDescriptionServed());
 			device_.sendXml(response, createDescription());
 		} else {
 			response.code = HTTP_STATUS_BAD_REQUEST;
 		}
 		return true;
-	}
 
-	if(uri.Path == device().resolvePath(getField(Field::controlURL))) {
+	case UrlType::control:
 		printRequest();
 		if(request.method == HTTP_POST) {
 			handleControl();
@@ -235,17 +410,83 @@ bool Service::onHttpRequest(HttpServerConnection& connection)
 			response.code = HTTP_STATUS_BAD_REQUEST;
 		}
 		return true;
-	}
 
-	if(uri.Path == device().resolvePath(getField(Field::eventSubURL))) {
+	case UrlType::eventSub:
 		printRequest(true);
-		// TODO: Handle this URL
 		if(request.method == HTTP_SUBSCRIBE || request.method == HTTP_UNSUBSCRIBE) {
 			handleSubscribe();
 		} else {
 			response.code = HTTP_STATUS_BAD_REQUEST;
 		}
 		return true;
+
+	default:
+		return false;
+	}
+}
+
+/*
+ * TIMEOUT is `Second-<n>` or `Second-infinite`. We grant at most maxSubscriptionTimeout.
+ */
+unsigned Service::getSubscriptionTimeout(const String& value)
+{
+	if(value.startsWith(F("Second-"))) {
+		auto n = strtoul(value.c_str() + 7, nullptr, 10);
+		if(n != 0 && n < maxSubscriptionTimeout) {
+			return n;
+		}
+	}
+	return maxSubscriptionTimeout;
+}
+
+void Service::expireSubscriptions()
+{
+	auto now = millis();
+	unsigned i = 0;
+	while(i < subscriptions_.count()) {
+		if(int32_t(subscriptions_[i].expiry - now) <= 0) {
+			debug_d("[UPnP] Subscription %s expired", subscriptions_[i].sid.c_str());
+			subscriptions_.removeElementAt(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+unsigned Service::subscriptionCount() const
+{
+	auto now = millis();
+	unsigned count{0};
+	for(unsigned i = 0; i < subscriptions_.count(); ++i) {
+		if(int32_t(subscriptions_[i].expiry - now) > 0) {
+			++count;
+		}
+	}
+	return count;
+}
+
+String Service::getUrlPath(UrlType type) const
+{
+	switch(type) {
+	case UrlType::description:
+		return device_.resolvePath(fieldValue(Field::SCPDURL));
+	case UrlType::control:
+		return device_.resolvePath(fieldValue(Field::controlURL));
+	case UrlType::eventSub:
+		return device_.resolvePath(fieldValue(Field::eventSubURL));
+	default:
+		return nullptr;
+	}
+}
+
+bool Service::onHttpRequest(HttpServerConnection& connection)
+{
+	auto& path = connection.getRequest()->uri.Path;
+
+	for(auto type : {UrlType::description, UrlType::control, UrlType::eventSub}) {
+		if(path == getUrlPath(type)) {
+			return handleUrlRequest(connection, type);
+		}
 	}
 
 	return false;
@@ -23,6 +23,11 @@
 
 namespace UPnP
 {
+ServiceControl::~ServiceControl()
+{
+	MulticastEvent::server.removeListener(*this);
+}
+
 bool ServiceControl::configure(const XML::Node* service)
 {
 	description_.controlURL = XML::getValue(service, F("controlURL"));
@@ -51,6 +56,16 @@ String ServiceControl::getField(Field desc) const
 	}
 }
 
+bool ServiceControl::onMulticastEvent(MulticastEvent::Server::Callback callback)
+{
+	if(!callback) {
+		MulticastEvent::server.removeListener(*this);
+		return true;
+	}
+
+	return MulticastEvent::server.addListener(*this, callback);
+}
+
 bool ServiceControl::sendRequest(HttpRequest* request) const
 {
 	return device().controlPoint().sendRequest(request);
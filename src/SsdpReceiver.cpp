@@ -0,0 +1,200 @@
+/**
+ * SsdpReceiver.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "SsdpReceiver.h"
+
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+
+#include "main.h"
+#include "include/Network/UPnP/DeviceHost.h"
+#include <Network/SSDP/Server.h>
+#include <Platform/System.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace
+{
+// How long the worker waits for data before checking whether it should stop
+constexpr int workerPollMs{100};
+
+// Limit work done in each task callback so other events are not held up
+constexpr unsigned maxDispatchCount{8};
+
+} // namespace
+
+namespace UPnP
+{
+bool SsdpReceiver::begin()
+{
+	if(running) {
+		return true;
+	}
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(fd < 0) {
+		debug_e("[SSDP] socket() failed");
+		return false;
+	}
+
+	int on{1};
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+	setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(SSDP::multicastPort);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+		debug_e("[SSDP] bind() failed");
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	DeviceHost::Interface intf;
+	for(unsigned i = 0; deviceHost.getInterface(i, intf); ++i) {
+		ip_mreq mreq{};
+		mreq.imr_multiaddr.s_addr = uint32_t(SSDP::multicastIp);
+		mreq.imr_interface.s_addr = uint32_t(intf.address);
+		if(setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0) {
+			groups.add(intf.address);
+		} else {
+			debug_w("[SSDP] Failed to join multicast group on %s", intf.address.toString().c_str());
+		}
+	}
+
+	if(groups.isEmpty()) {
+		debug_e("[SSDP] Failed to join multicast group");
+		close(fd);
+		fd = -1;
+		return false;
+	}
+
+	running = true;
+	thread = std::thread(&SsdpReceiver::run, this);
+
+	debug_i("[SSDP] Threaded receiver started");
+	return true;
+}
+
+void SsdpReceiver::end()
+{
+	if(!running) {
+		return;
+	}
+
+	running = false;
+	if(thread.joinable()) {
+		thread.join();
+	}
+	close(fd);
+	fd = -1;
+	groups.clear();
+
+	// Discard anything not yet dispatched
+	while(ring.front() != nullptr) {
+		ring.pop();
+	}
+}
+
+/*
+ * Worker thread. Only the ring and atomic counters are shared with the main thread.
+ */
+void SsdpReceiver::run()
+{
+	pollfd pfd{fd, POLLIN, 0};
+
+	while(running) {
+		if(poll(&pfd, 1, workerPollMs) <= 0) {
+			continue;
+		}
+
+		auto packet = ring.reserve();
+		char discard[maxPacketSize];
+		sockaddr_in from{};
+		socklen_t fromLen = sizeof(from);
+		auto buffer = packet ? packet->data : discard;
+		auto size = recvfrom(fd, buffer, maxPacketSize, 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
+		if(size <= 0) {
+			continue;
+		}
+
+		if(packet == nullptr) {
+			++dropped;
+			continue;
+		}
+
+		buffer[size] = '\0';
+		auto& msg = packet->msg;
+		if(msg.parse(buffer, size) != HPE_OK) {
+			continue;
+		}
+		msg.remoteIP = from.sin_addr.s_addr;
+		msg.remotePort = ntohs(from.sin_port);
+
+		ring.commit();
+		queueDispatch();
+	}
+}
+
+/*
+ * Called by the worker after adding to the ring, and by dispatch() if it leaves messages behind.
+ * Only one task is queued at a time.
+ */
+void SsdpReceiver::queueDispatch()
+{
+	if(dispatchQueued.exchange(true)) {
+		return;
+	}
+
+	auto callback = [](void* param) { static_cast<SsdpReceiver*>(param)->dispatch(); };
+	if(!System.queueCallback(callback, this)) {
+		// Task queue full: try again when the next datagram arrives
+		dispatchQueued = false;
+	}
+}
+
+void SsdpReceiver::dispatch()
+{
+	// Clear first so a message committed while we're dispatching queues another task
+	dispatchQueued = false;
+
+	for(unsigned i = 0; i < maxDispatchCount; ++i) {
+		auto packet = ring.front();
+		if(packet == nullptr) {
+			return;
+		}
+
+		dispatchSsdpMessage(packet->msg);
+		ring.pop();
+	}
+
+	if(ring.front() != nullptr) {
+		queueDispatch();
+	}
+}
+
+} // namespace UPnP
+
+#endif
@@ -0,0 +1,143 @@
+/****
+ * SsdpReceiver.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+
+#include <Network/SSDP/Message.h>
+#include <IpAddress.h>
+#include <WVector.h>
+#include <atomic>
+#include <thread>
+
+namespace UPnP
+{
+/**
+ * @brief Fixed-size single-producer, single-consumer ring buffer
+ * @tparam T Item type
+ * @tparam size Number of slots, must be a power of 2
+ *
+ * Producer calls `reserve()` to get a free slot, fills it then calls `commit()`.
+ * Consumer calls `front()` to get the oldest item and `pop()` once it has finished with it.
+ */
+template <typename T, unsigned size> class SpscRing
+{
+	static_assert((size & (size - 1)) == 0, "Ring size must be a power of 2");
+
+public:
+	T* reserve()
+	{
+		auto h = head.load(std::memory_order_relaxed);
+		if(h - tail.load(std::memory_order_acquire) == size) {
+			return nullptr;
+		}
+		return &items[h % size];
+	}
+
+	void commit()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	T* front()
+	{
+		auto t = tail.load(std::memory_order_relaxed);
+		if(t == head.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &items[t % size];
+	}
+
+	void pop()
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	T items[size];
+	std::atomic<unsigned> head{0};
+	std::atomic<unsigned> tail{0};
+};
+
+/**
+ * @brief Receives and parses SSDP multicast datagrams on a worker thread
+ *
+ * Multicast traffic (NOTIFY and M-SEARCH) is received using a native socket so that bursts
+ * do not hold up the main event loop. When the ring becomes non-empty the worker queues a task
+ * to dispatch the parsed messages as normal. Unicast traffic, i.e. search responses and unicast
+ * M-SEARCH requests, still arrives via the SSDP server.
+ *
+ * The native socket uses the host network stack, not lwIP, so the group can only be joined on
+ * interfaces whose address is also configured on the host. Multicasts arriving on other interfaces
+ * are still received via the SSDP server: see `isJoined()`.
+ */
+class SsdpReceiver
+{
+public:
+	~SsdpReceiver()
+	{
+		end();
+	}
+
+	bool begin();
+	void end();
+
+	/**
+	 * @brief Determine whether multicasts for an interface are received by this worker
+	 * @param address Local interface address
+	 */
+	bool isJoined(IpAddress address) const
+	{
+		return groups.contains(address);
+	}
+
+	/**
+	 * @brief Number of datagrams dropped because the ring was full
+	 */
+	unsigned droppedCount() const
+	{
+		return dropped;
+	}
+
+private:
+	static constexpr unsigned maxPacketSize{1500};
+	static constexpr unsigned ringSize{32};
+
+	struct Packet {
+		char data[maxPacketSize + 1];
+		SSDP::BasicMessage msg;
+	};
+
+	void run();
+	void queueDispatch();
+	void dispatch();
+
+	SpscRing<Packet, ringSize> ring;
+	std::thread thread;
+	std::atomic<bool> running{false};
+	std::atomic<bool> dispatchQueued{false}; ///< Set while a dispatch task is pending
+	std::atomic<unsigned> dropped{0};
+	Vector<IpAddress> groups; ///< Interfaces on which the multicast group was joined
+	int fd{-1};
+};
+
+} // namespace UPnP
+
+#endif
@@ -0,0 +1,252 @@
+/**
+ * StatusStream.cpp
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Network/UPnP/StatusStream.h"
+#include "include/Network/UPnP/DeviceHost.h"
+
+#if defined(ARCH_ESP32)
+#include <esp_heap_caps.h>
+#elif defined(ARCH_ESP8266)
+extern "C" size_t umm_max_free_block_size();
+#endif
+
+namespace UPnP
+{
+namespace
+{
+class StringPrint : public Print
+{
+public:
+	StringPrint(String& s) : s(s)
+	{
+	}
+
+	size_t write(uint8_t c) override
+	{
+		return s.concat(char(c)) ? 1 : 0;
+	}
+
+	size_t write(const uint8_t* buffer, size_t size) override
+	{
+		return s.concat(reinterpret_cast<const char*>(buffer), size) ? size : 0;
+	}
+
+private:
+	String& s;
+};
+
+/*
+ * Largest single allocation currently possible, or 0 if the platform doesn't say
+ */
+size_t getMaxFreeBlock()
+{
+#if defined(ARCH_ESP32)
+	return heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+#elif defined(ARCH_ESP8266)
+	return umm_max_free_block_size();
+#else
+	return 0;
+#endif
+}
+
+} // namespace
+
+StatusStream::StatusStream(DeviceHost& host) : host(host)
+{
+	host.statusStreams.add(this);
+	getContent();
+}
+
+StatusStream::~StatusStream()
+{
+	host.statusStreams.removeElement(this);
+}
+
+uint16_t StatusStream::readMemoryBlock(char* data, int bufSize)
+{
+	if(bufSize <= 0 || !content) {
+		return 0;
+	}
+
+	auto len = std::min(size_t(bufSize), content.length() - readPos);
+	memcpy(data, &content[readPos], len);
+	return len;
+}
+
+bool StatusStream::seek(int len)
+{
+	if(len <= 0 || content.length() == 0) {
+		return false;
+	}
+
+	unsigned newPos = readPos + len;
+	if(newPos > content.length()) {
+		debug_e("[UPnP] seek(%d) out of range, max %u", len, content.length());
+		return false;
+	}
+
+	if(newPos < content.length()) {
+		readPos = newPos;
+		return true;
+	}
+
+	getContent();
+	readPos = 0;
+	return true;
+}
+
+/*
+ * DeviceHost advances `nextDevice` if that device is unregistered, so registering or removing
+ * a device whilst the stream is being read is safe.
+ */
+void StatusStream::getContent()
+{
+	content.setLength(0);
+	while(content.length() == 0) {
+		switch(state) {
+		case State::header:
+			content += _F("{\"devices\":[");
+			nextDevice = host.devices().head();
+			state = State::device;
+			break;
+
+		case State::device: {
+			auto device = nextDevice;
+			if(device == nullptr) {
+				content += ']';
+				state = State::footer;
+				break;
+			}
+			if(!firstDevice) {
+				content += ',';
+			}
+			firstDevice = false;
+			nextDevice = device->getNext();
+			addDevice(*device);
+			break;
+		}
+
+		case State::footer: {
+			auto& stats = host.searchStats();
+			content += _F(",\"ssdp\":{\"pendingMessages\":");
+			content += host.pendingMessageCount();
+			content += _F(",\"searches\":{\"received\":");
+			content += stats.received;
+			content += _F(",\"invalid\":");
+			content += stats.invalid;
+			content += _F(",\"rateLimited\":");
+			content += stats.rateLimited;
+			content += _F(",\"untracked\":");
+			content += stats.untracked;
+			content += _F(",\"duplicates\":");
+			content += stats.duplicates;
+			content += _F(",\"responsesQueued\":");
+			content += stats.responsesQueued;
+			content += _F(",\"responsesDropped\":");
+			content += stats.responsesDropped;
+			content += _F("}},\"metrics\":");
+#if UPNP_ENABLE_METRICS
+			StringPrint p(content);
+			host.metrics().printTo(p);
+#else
+			content += _F("{\"enabled\":false}");
+#endif
+			host.checkHeap();
+			content += _F(",\"heap\":{\"free\":");
+			content += system_get_free_heap_size();
+			content += _F(",\"minFree\":");
+			content += host.minFreeHeap();
+			content += _F(",\"maxBlock\":");
+			auto maxBlock = getMaxFreeBlock();
+			if(maxBlock == 0) {
+				content += _F("null");
+			} else {
+				content += maxBlock;
+			}
+			content += _F("}}");
+			state = State::done;
+			break;
+		}
+
+		case State::done:
+		default:
+			content = nullptr;
+			return;
+		}
+	}
+}
+
+void StatusStream::addDevice(Device& device)
+{
+	content += _F("{\"type\":");
+	addString(toString(device.objectType()));
+	content += _F(",\"friendlyName\":");
+	addString(device.fieldValue(Device::Field::friendlyName));
+	content += _F(",\"udn\":");
+	addString(device.fieldValue(Device::Field::UDN));
+
+	content += _F(",\"services\":[");
+	for(auto service = device.services().head(); service != nullptr; service = service->getNext()) {
+		if(service != device.services().head()) {
+			content += ',';
+		}
+		addService(*service);
+	}
+
+	content += _F("],\"devices\":[");
+	for(auto dev = device.devices().head(); dev != nullptr; dev = dev->getNext()) {
+		if(dev != device.devices().head()) {
+			content += ',';
+		}
+		addDevice(*dev);
+	}
+	content += _F("]}");
+}
+
+void StatusStream::addService(Service& service)
+{
+	content += _F("{\"type\":");
+	addString(toString(service.objectType()));
+	content += _F(",\"serviceId\":");
+	addString(service.fieldValue(Service::Field::serviceId));
+	content += _F(",\"subscriptions\":");
+	content += service.subscriptionCount();
+	content += '}';
+}
+
+void StatusStream::addString(const String& value)
+{
+	content += '"';
+	for(unsigned i = 0; i < value.length(); ++i) {
+		char c = value[i];
+		if(c == '"' || c == '\\') {
+			content += '\\';
+			content += c;
+		} else if(uint8_t(c) < 0x20) {
+			content += _F("\\u00");
+			content += hexchar(uint8_t(c) >> 4);
+			content += hexchar(c & 0x0f);
+		} else {
+			content += c;
+		}
+	}
+	content += '"';
+}
+
+} // namespace UPnP
@@ -0,0 +1,250 @@
+/****
+ * ActionDispatch.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ActionRequest.h"
+#include "Error.h"
+
+namespace UPnP
+{
+/**
+ * @brief Support for table-driven action dispatch
+ *
+ * Generated service templates may use a `Table` to locate the handler for an incoming action
+ * in constant time, rather than comparing the name against each action in turn.
+ * The table is constructed at compile time, for example:
+ *
+ * 	using Handler = Error (MyService::*)(ActionRequest& req);
+ * 	static constexpr ActionDispatch::Table<Handler, 2> actions{{
+ * 		UPNP_ACTION_INFO(Play, &MyService::handlePlay, playArgs),
+ * 		UPNP_ACTION_INFO_NOARGS(Stop, &MyService::handleStop),
+ * 	}};
+ *
+ * 	Error handleAction(ActionRequest& req) override
+ * 	{
+ * 		return actions.dispatch(*this, req);
+ * 	}
+ */
+/**
+ * @brief Define an ActionInfo entry, with the hash computed from the action name
+ * @param name Action name, without quotes. The corresponding FlashString `fs_<name>` must be defined.
+ * @param handler Pointer to service member function
+ * @param args Array of ArgInfo
+ */
+#define UPNP_ACTION_INFO(name, handler, args)                                                                          \
+	{                                                                                                                  \
+		UPnP::ActionDispatch::hash(#name), &fs_##name, handler, args, ARRAY_SIZE(args)                                 \
+	}
+
+/**
+ * @brief Define an ActionInfo entry for an action with no input arguments
+ * @param name Action name, without quotes. The corresponding FlashString `fs_<name>` must be defined.
+ * @param handler Pointer to service member function
+ */
+#define UPNP_ACTION_INFO_NOARGS(name, handler)                                                                         \
+	{                                                                                                                  \
+		UPnP::ActionDispatch::hash(#name), &fs_##name, handler, nullptr, 0                                             \
+	}
+
+namespace ActionDispatch
+{
+/**
+ * @brief FNV-1a hash, identical to ObjectIndex::hash() but usable at compile time
+ */
+constexpr uint32_t hash(const char* s, size_t length)
+{
+	uint32_t h{2166136261U};
+	for(size_t i = 0; i < length; ++i) {
+		h ^= uint8_t(s[i]);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+template <size_t N> constexpr uint32_t hash(const char (&s)[N])
+{
+	return hash(s, N - 1);
+}
+
+/**
+ * @brief UPnP argument data types which may be validated before dispatch
+ */
+enum class ArgType : uint8_t {
+	string,
+	boolean,
+	ui1,
+	ui2,
+	ui4,
+	i1,
+	i2,
+	i4,
+	r4,
+	r8,
+};
+
+/**
+ * @brief Describes an input argument for an action
+ */
+struct ArgInfo {
+	const FlashString* name;
+	ArgType type;
+};
+
+/**
+ * @brief Describes an action
+ * @tparam Handler Pointer to service member function
+ * @note Use UPNP_ACTION_INFO to ensure hash and name match
+ */
+template <typename Handler> struct ActionInfo {
+	uint32_t hash; ///< `ActionDispatch::hash(name)`
+	const FlashString* name;
+	Handler handler;
+	const ArgInfo* args;
+	uint8_t argCount;
+};
+
+/**
+ * @brief Check all input arguments are present and valid for their type
+ */
+bool checkArgs(const ActionRequest& req, const ArgInfo* args, unsigned argCount);
+
+/**
+ * @brief Hash table mapping action names to handlers
+ * @tparam Handler Pointer to service member function
+ * @tparam actionCount Number of actions
+ *
+ * The constructor searches for a seed which gives each action its own slot,
+ * so lookups require a single probe and name comparison.
+ * Should no such seed be found, colliding entries are placed using linear probing.
+ */
+template <typename Handler, size_t actionCount> class Table
+{
+	static_assert(actionCount != 0 && actionCount < 64, "Action count out of range");
+
+public:
+	using Entry = ActionInfo<Handler>;
+
+	constexpr Table(const Entry (&actions)[actionCount])
+	{
+		for(unsigned i = 0; i < actionCount; ++i) {
+			entries[i] = actions[i];
+		}
+
+		for(uint32_t s = 0; s < maxSeed; ++s) {
+			if(fill(s)) {
+				break;
+			}
+		}
+	}
+
+	const Entry* find(const char* name, size_t length) const
+	{
+		auto h = hash(name, length);
+		for(auto i = slotIndex(h); slots[i] != emptySlot; i = (i + 1) & slotMask) {
+			auto& entry = entries[slots[i]];
+			if(entry.hash == h && entry.name->equals(name, length)) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	const Entry* find(const String& name) const
+	{
+		return find(name.c_str(), name.length());
+	}
+
+	/**
+	 * @brief Validate arguments and invoke handler for a request
+	 * @param service Object on which to invoke the handler
+	 * @param req
+	 * @retval Error
+	 */
+	template <class Service> Error dispatch(Service& service, ActionRequest& req) const
+	{
+		auto entry = find(req.actionName());
+		if(entry == nullptr) {
+			// A mismatched hash would make its action unreachable
+			assert(verify());
+			return Error::ActionInvalid;
+		}
+		if(!checkArgs(req, entry->args, entry->argCount)) {
+			return Error::ActionArgsInvalid;
+		}
+		return (service.*(entry->handler))(req);
+	}
+
+	/**
+	 * @brief Check the hash of each entry matches its name
+	 */
+	bool verify() const
+	{
+		for(auto& entry : entries) {
+			String name(*entry.name);
+			if(entry.hash != hash(name.c_str(), name.length())) {
+				debug_e("[UPnP] Action '%s' has incorrect hash", name.c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	static constexpr unsigned slotBits = (actionCount < 4) ? 4 : (actionCount < 8) ? 5 : (actionCount < 16) ? 6 : 8;
+	static constexpr unsigned slotCount = 1U << slotBits;
+	static constexpr unsigned slotMask = slotCount - 1;
+	static constexpr uint8_t emptySlot{0xff};
+	static constexpr uint32_t maxSeed{256};
+
+	constexpr unsigned slotIndex(uint32_t h) const
+	{
+		return ((h ^ seed) * 0x9E3779B1U) >> (32 - slotBits);
+	}
+
+	/*
+	 * Place entries using the given seed
+	 * Returns true if no collisions occurred
+	 */
+	constexpr bool fill(uint32_t s)
+	{
+		seed = s;
+		for(unsigned i = 0; i < slotCount; ++i) {
+			slots[i] = emptySlot;
+		}
+
+		bool perfect{true};
+		for(unsigned i = 0; i < actionCount; ++i) {
+			auto slot = slotIndex(entries[i].hash);
+			while(slots[slot] != emptySlot) {
+				perfect = false;
+				slot = (slot + 1) & slotMask;
+			}
+			slots[slot] = i;
+		}
+		return perfect;
+	}
+
+	Entry entries[actionCount]{};
+	uint8_t slots[slotCount]{};
+	uint32_t seed{0};
+};
+
+} // namespace ActionDispatch
+} // namespace UPnP
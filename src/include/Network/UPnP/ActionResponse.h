@@ -22,6 +22,7 @@
 #include "Envelope.h"
 #include <Data/Stream/MemoryDataStream.h>
 #include "LinkedItemList.h"
+#include "Metrics.h"
 
 class HttpServerConnection;
 
@@ -64,6 +65,10 @@ public:
 			return envelope;
 		}
 
+#if UPNP_ENABLE_METRICS
+		uint32_t startTime{0}; ///< micros() when request was received
+#endif
+
 	private:
 		friend ActionResponse;
 
@@ -95,6 +100,11 @@ public:
 		return value;
 	}
 
+	const char* getArgValue(const String& name) const
+	{
+		return envelope.getArgValue(name);
+	}
+
 	template <typename T> void setArg(const FlashString& name, const T& value) const
 	{
 		envelope.addArg(name, value);
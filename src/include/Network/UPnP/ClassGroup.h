@@ -25,11 +25,29 @@
 namespace UPnP
 {
 struct ClassGroup {
+	/**
+	 * @brief Registered class groups
+	 *
+	 * Classes are indexed by hash when their group is added, so lookups
+	 * only need to read the matching class from flash.
+	 */
 	class List : public Vector<ClassGroup>
 	{
 	public:
 		int add(const FlashString& domain, const ObjectClass::List& classes);
 		const ObjectClass* find(const Urn& objectType) const;
+
+	private:
+		struct IndexEntry {
+			uint32_t hash;
+			const ObjectClass* cls;
+		};
+
+		void removeIndexEntries(const ObjectClass::List& classes, unsigned classCount);
+		unsigned lowerBound(uint32_t hash) const;
+		unsigned upperBound(uint32_t hash) const;
+
+		Vector<IndexEntry> index; ///< Sorted by hash
 	};
 
 	const FlashString& domain;
@@ -67,6 +67,20 @@ public:
 		rootDevices.clear();
 	}
 
+	/**
+	 * @brief Allocate each discovered device tree from a single memory arena
+	 * @param blockSize Size of each arena block, 0 to allocate objects individually (the default)
+	 *
+	 * Devices, services and their description strings are normally allocated separately.
+	 * Where many devices are being tracked this can fragment the heap.
+	 * With an arena, memory is released in one go when the root device is destroyed.
+	 * A block size comparable to the total size of a typical device tree works best.
+	 */
+	void setArenaBlockSize(size_t blockSize)
+	{
+		arenaBlockSize = blockSize;
+	}
+
 	/**
 	 * @brief Searches for UPnP device or service and returns SSDP response messages
 	 * @param urn unique identifier of the service or device to find
@@ -192,6 +206,7 @@ private:
 	DeviceControl::OwnedList rootDevices;
 	static HttpClient http;
 	size_t maxResponseSize; // <<< Maximum size of XML description that can be processed
+	size_t arenaBlockSize{0};
 	CStringArray uniqueServiceNames;
 	std::unique_ptr<Search> activeSearch;
 };
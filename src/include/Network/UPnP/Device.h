@@ -20,6 +20,7 @@
 #pragma once
 
 #include "Service.h"
+#include "FieldCache.h"
 
 #define UPNP_DEVICE_FIELD_MAP(XX)                                                                                      \
 	XX(deviceType, required)                                                                                           \
@@ -91,6 +92,26 @@ public:
 	 */
 	virtual String getUrl(const String& path) const;
 
+	/**
+	 * @brief Set the HTTP port for this root device
+	 * @param port 0 (default) if application serves device on port 80 using its own HttpServer
+	 * @note Must be set before registering device. DeviceHost will create and manage an HttpServer
+	 * for each port in use, so separate root devices do not block each other.
+	 */
+	void setHttpPort(uint16_t port)
+	{
+		assert(isRoot());
+		httpPort_ = port;
+	}
+
+	/**
+	 * @brief Get the HTTP port set for this device tree
+	 */
+	uint16_t httpPort() const
+	{
+		return root().httpPort_;
+	}
+
 	/**
 	 * @brief Get the base URL path
 	 */
@@ -134,10 +155,52 @@ public:
 	}
 
 	void search(const SearchFilter& filter) override;
+
+	/**
+	 * @brief Report matches for this device only, excluding its services and embedded devices
+	 */
+	void matchSearch(const SearchFilter& filter);
+
 	bool formatMessage(Message& msg, MessageSpec& ms) override;
 
 	virtual String getField(Field desc) const;
 
+	/**
+	 * @brief Enable caching of field values for this device, its services and embedded devices
+	 *
+	 * Values are computed when the device is registered, and for each interface address as it is first used.
+	 * Call `updateFieldCache()` if the application changes any field values after registration.
+	 */
+	void enableFieldCache(bool enable = true);
+
+	/**
+	 * @brief Rebuild the field cache for this device, its services and embedded devices
+	 */
+	void updateFieldCache();
+
+	/**
+	 * @brief Get a cached field value for the current local address
+	 * @retval const char* nullptr if caching is not enabled
+	 */
+	const char* getCachedField(Field desc) const
+	{
+		return getCachedValue(unsigned(desc));
+	}
+
+	/**
+	 * @brief Get a field value, using the cache if enabled
+	 */
+	String fieldValue(Field desc) const
+	{
+		auto s = getCachedField(desc);
+		return s ? String(s) : getField(desc);
+	}
+
+	/**
+	 * @brief Get the fully-qualified description URL, as sent in the SSDP LOCATION header
+	 */
+	String getLocation() const;
+
 	Urn objectType() const override
 	{
 		return DeviceUrn(getField(Field::domain), getField(Field::type), version());
@@ -149,6 +212,8 @@ public:
 	}
 
 	bool onHttpRequest(HttpServerConnection& connection) override;
+	String getUrlPath(UrlType type) const override;
+	bool handleUrlRequest(HttpServerConnection& connection, UrlType type) override;
 
 	void addDevice(Device* device)
 	{
@@ -184,9 +249,29 @@ public:
 	}
 
 private:
+	// Values cached in addition to fields
+	enum CacheIndex {
+		cacheLocation = unsigned(Field::MAX),
+		cacheRootUsn,
+		cacheTypeUsn,
+		cacheCount,
+	};
+
+	String getCacheValue(unsigned index) const;
+	const char* getCachedValue(unsigned index) const;
+	bool formatCachedMessage(Message& msg, MessageSpec& ms);
+
+	bool fieldIs(Field desc, const String& value) const
+	{
+		auto s = getCachedField(desc);
+		return s ? value == s : value == getField(desc);
+	}
+
 	Device& parent_;
 	Service::OwnedList services_;
 	Device::OwnedList devices_;
+	mutable FieldCache fieldCache_;
+	uint16_t httpPort_{0};
 };
 
 } // namespace UPnP
@@ -21,7 +21,8 @@
 
 #include "Device.h"
 #include "ServiceControl.h"
-#include <Data/CString.h>
+#include "ObjectArena.h"
+#include "InternedString.h"
 #include <Network/SSDP/Uuid.h>
 
 namespace UPnP
@@ -34,14 +35,17 @@ public:
 	using List = ObjectList<DeviceControl>;
 	using OwnedList = OwnedObjectList<DeviceControl>;
 
+	/*
+	 * Fields typically shared by many devices are interned
+	 */
 	struct Description {
-		CString udn;
-		CString friendlyName;
-		CString manufacturer;
-		CString modelName;
-		CString modelNumber;
-		CString modelDescription;
-		CString serialNumber;
+		ArenaString udn;
+		ArenaString friendlyName;
+		InternedString manufacturer;
+		InternedString modelName;
+		InternedString modelNumber;
+		InternedString modelDescription;
+		ArenaString serialNumber;
 	};
 
 	DeviceControl(DeviceControl& parent) : Device(parent)
@@ -52,6 +56,20 @@ public:
 	{
 	}
 
+	/*
+	 * Objects are allocated from the current ObjectArena, if there is one.
+	 * A failed allocation yields nullptr rather than throwing, so callers must check.
+	 */
+	static void* operator new(size_t size) noexcept
+	{
+		return ObjectArena::allocate(size);
+	}
+
+	static void operator delete(void* ptr)
+	{
+		ObjectArena::free(ptr);
+	}
+
 	/**
 	 * @brief Called on root device only during discovery
 	 */
@@ -160,8 +178,18 @@ protected:
 
 	struct RootConfig {
 		ControlPoint& controlPoint;
-		CString baseUrl;  ///< e.g. "http://192.168.1.1:80"
-		CString basePath; ///< Includes trailing path separator, e.g. "/devices/1/"
+		ArenaString baseUrl;  ///< e.g. "http://192.168.1.1:80"
+		ArenaString basePath; ///< Includes trailing path separator, e.g. "/devices/1/"
+
+		static void* operator new(size_t size) noexcept
+		{
+			return ObjectArena::allocate(size);
+		}
+
+		static void operator delete(void* ptr)
+		{
+			ObjectArena::free(ptr);
+		}
 	};
 	std::unique_ptr<RootConfig> rootConfig;
 };
@@ -20,12 +20,40 @@
 #pragma once
 
 #include "Device.h"
+#include "ObjectIndex.h"
+#include "SearchLimiter.h"
+#include "Metrics.h"
+#include <Timer.h>
+#include <WVector.h>
+#include <Network/HttpServer.h>
 
 namespace UPnP
 {
+class SearchCursor;
+class EnvelopeParser;
+class StatusStream;
+
 class DeviceHost
 {
 public:
+	/**
+	 * @brief A network interface on which devices are advertised and served
+	 */
+	struct Interface {
+		IpAddress address;
+		IpAddress netmask;
+
+		bool contains(IpAddress ip) const
+		{
+			return ip.compare(address, netmask);
+		}
+
+		bool operator==(const Interface& other) const
+		{
+			return address == other.address;
+		}
+	};
+
 	/**
 	 * @brief Applications must call this to initialise UPnP stack
 	 */
@@ -37,15 +65,134 @@ public:
 
 	bool registerDevice(Device* device);
 
-	bool unRegisterDevice(Device* device);
+	/**
+	 * @brief Callback invoked when a device has been removed
+	 * @param device The device passed to `unRegisterDevice()`
+	 */
+	using DeviceCallback = Delegate<void(Device& device)>;
+
+	/**
+	 * @brief Remove a device from the stack
+	 * @param device
+	 * @param callback Invoked when all ssdp:byebye messages have been sent
+	 * @retval bool false if device was not registered
+	 *
+	 * The device stops responding to new requests immediately. The callback is invoked
+	 * once the framework has finished with the device, so the application may then destroy it.
+	 * If the device is registered again before this happens the callback is not invoked.
+	 */
+	bool unRegisterDevice(Device* device, DeviceCallback callback);
+
+	bool unRegisterDevice(Device* device)
+	{
+		return unRegisterDevice(device, nullptr);
+	}
+
+	/**
+	 * @brief Select which WiFi interfaces are used
+	 * @param station Default is true
+	 * @param accessPoint Default is false
+	 */
+	void setWifiInterfaces(bool station, bool accessPoint)
+	{
+		useStation = station;
+		useAccessPoint = accessPoint;
+	}
+
+	/**
+	 * @brief Add another network interface, such as Ethernet
+	 * @param address Local IP address for the interface
+	 * @param netmask Network mask, used to determine which interface a client is on
+	 * @retval bool
+	 */
+	bool addInterface(IpAddress address, IpAddress netmask);
+
+	/**
+	 * @brief Remove an interface added by `addInterface()`
+	 * @param address Local IP address for the interface
+	 * @retval bool false if interface not found
+	 */
+	bool removeInterface(IpAddress address);
+
+	/**
+	 * @brief Get an active network interface
+	 * @param index Station and access point interfaces (if enabled) come first
+	 * @param intf On success, contains interface information
+	 * @retval bool false if index is out of range
+	 */
+	bool getInterface(unsigned index, Interface& intf) const;
+
+	/**
+	 * @brief Get number of active network interfaces
+	 */
+	unsigned getInterfaceCount() const;
+
+	/**
+	 * @brief Find the local interface on the same network as a remote address
+	 * @param remoteIp
+	 * @param intf On success, contains interface information
+	 * @retval bool false if remote address is not on a local network
+	 */
+	bool findInterface(IpAddress remoteIp, Interface& intf) const;
+
+	/**
+	 * @brief Get the local IP address to use when constructing URLs
+	 *
+	 * This is the address of the interface on which the current request arrived
+	 * or message is being sent, or the first active interface otherwise.
+	 */
+	IpAddress getLocalAddress() const;
 
+	/**
+	 * @brief Dispatch an incoming HTTP request to the owning device or service
+	 * @retval bool true if request was handled
+	 *
+	 * URL paths are looked up in a routing table built when devices are registered.
+	 * Requests from clients which are not on the same network as one of our interfaces are rejected.
+	 *
+	 * Applications using their own HttpServer should call this from their default request handler.
+	 * Root devices with an HTTP port set are served by an HttpServer owned by DeviceHost.
+	 */
 	bool onHttpRequest(HttpServerConnection& connection);
 
+	/**
+	 * @brief Rebuild routing table and search index entries for a registered device
+	 * @note Call this if a device changes any of its URLs, types or UDNs after registration,
+	 * or adds or removes services or embedded devices.
+	 */
+	void updateIndex(Device* device);
+
 	/**
 	 * @brief Create an HTML page which applications may serve up to assist with debugging
+	 * @see generateStatus()
 	 */
 	IDataSourceStream* generateDebugPage(const String& title);
 
+	/**
+	 * @brief Create a JSON document describing devices, services, SSDP queues, metrics and heap usage
+	 * @retval IDataSourceStream* A StatusStream, which generates content as it is read
+	 *
+	 * Intended for monitoring tools. Content is produced one root device at a time so
+	 * memory use stays low regardless of the number of devices.
+	 */
+	IDataSourceStream* generateStatus();
+
+#if UPNP_ENABLE_METRICS
+	/**
+	 * @brief Access instrumentation counters and timings
+	 * @note Only available when built with UPNP_ENABLE_METRICS=1
+	 */
+	Metrics& metrics()
+	{
+		return UPnP::metrics;
+	}
+
+	/**
+	 * @brief Create a JSON document containing current metrics, which applications may serve up for monitoring
+	 */
+	IDataSourceStream* generateMetrics();
+#endif
+
 	Device::List& devices()
 	{
 		return devices_;
@@ -53,15 +200,224 @@ public:
 
 	void notify(Device* device, NotifySubtype subype);
 
+	/**
+	 * @brief Set the advertisement lifetime sent in the CACHE-CONTROL header
+	 * @param seconds Default is 1800. Values are clamped to the range 1800 to 86400 (one day).
+	 *
+	 * Each root device tree is re-announced before this expires, at a randomised
+	 * fraction of less than half its value. Announcements for multiple devices are
+	 * spread out across the interval.
+	 */
+	void setMaxAge(unsigned seconds);
+
+	unsigned maxAge() const
+	{
+		return maxAge_;
+	}
+
+	/**
+	 * @brief Set the BOOTID.UPNP.ORG value sent with UPnP 2.0 multicast events
+	 * @param id Must be non-zero and increase each time the device restarts,
+	 * so applications should store it persistently
+	 * @note If not set, the time of the first call to `begin()` is used, provided the system clock has been set.
+	 * Otherwise multicast events are not sent until this method is called.
+	 */
+	void setBootId(uint32_t id)
+	{
+		bootId_ = id & 0x7fffffff;
+	}
+
+	/**
+	 * @brief Get the BOOTID.UPNP.ORG value
+	 * @retval uint32_t 0 if not yet set
+	 */
+	uint32_t bootId() const
+	{
+		return bootId_;
+	}
+
+	/**
+	 * @brief Set the maximum length of an incoming action argument value
+	 * @param size Default is UPNP_MAX_ARG_SIZE
+	 * @note Requests exceeding this fail with a `StringArgumentTooLong` fault.
+	 * Applies only when UPNP_STREAM_SOAP_REQUESTS is enabled.
+	 */
+	void setMaxArgSize(size_t size)
+	{
+		maxArgSize_ = size;
+	}
+
+	size_t maxArgSize() const
+	{
+		return maxArgSize_;
+	}
+
+	/**
+	 * @brief Take ownership of an action request parsed as it was received
+	 * @retval EnvelopeParser* nullptr if the request did not arrive via a DeviceHost server
+	 * @note Called by Service when handling a control request
+	 */
+	EnvelopeParser* takeSoapParser(HttpServerConnection& connection);
+
+	/**
+	 * @brief Set limit on number of SSDP messages pending at any one time
+	 * @note Excess search responses and notifications are dropped
+	 */
+	void setMaxQueuedMessages(unsigned count)
+	{
+		maxQueuedMessages = count;
+	}
+
+	/**
+	 * @brief Get number of SSDP messages currently pending
+	 */
+	unsigned pendingMessageCount() const
+	{
+		return pendingMessages;
+	}
+
+	/**
+	 * @brief Access M-SEARCH rate limiting configuration and statistics
+	 */
+	SearchLimiter& searchLimiter()
+	{
+		return searchLimiter_;
+	}
+
+	const SearchStats& searchStats() const
+	{
+		return searchLimiter_.stats;
+	}
+
 	/**
 	 * @brief Called via SSDP when incoming message received
+	 * @note Requests are dropped if the source exceeds its rate limit,
+	 * or if the same query from that source is still being answered.
 	 */
 	void onSearchRequest(const BasicMessage& request);
 
+	/**
+	 * @brief Lowest free heap seen since `begin()`
+	 * @note Sampled when handling SSDP and HTTP requests, whether or not metrics are enabled
+	 */
+	uint32_t minFreeHeap() const
+	{
+		return minFreeHeap_;
+	}
+
 private:
-	void search(SearchFilter& filter, Device* device);
+	friend SearchCursor;
+	friend StatusStream;
+
+	void checkHeap()
+	{
+		auto freeHeap = system_get_free_heap_size();
+		if(freeHeap < minFreeHeap_) {
+			minFreeHeap_ = freeHeap;
+		}
+	}
+
+	SearchCursor* search(SearchFilter& filter, Device* device, uint32_t windowMs);
+	SearchCursor* notifyDevice(Device* device, NotifySubtype subtype);
+	void onCursorMessageSent(SearchCursor& cursor);
+	void removeCursor(SearchCursor& cursor);
+	void cancelCursors(Device* device, bool notifyCompletion = true);
+	void completeRemoval(Device* device);
+	bool isDuplicateSearch(const MessageSpec& ms, const String& targetString);
+	class ServerResource;
+
+	/*
+	 * Removal completion waiting to be reported, when there were no byebye messages to send
+	 */
+	struct PendingRemoval {
+		Device* device;
+		DeviceCallback callback;
+
+		bool operator==(const PendingRemoval& other) const
+		{
+			return device == other.device;
+		}
+	};
+
+	/*
+	 * Action request being parsed, held here until collected by the service
+	 */
+	struct SoapRequest {
+		HttpServerConnection* connection;
+		EnvelopeParser* parser;
+
+		bool operator==(const SoapRequest& other) const
+		{
+			return connection == other.connection;
+		}
+	};
+
+	struct PortServer {
+		HttpServer* server;
+		uint16_t port;
+		uint16_t refCount;
+
+		bool operator==(const PortServer& other) const
+		{
+			return port == other.port;
+		}
+	};
+
+	bool addServer(uint16_t port);
+	void releaseServer(uint16_t port);
+	void setActiveAddress(IpAddress address)
+	{
+		activeAddress = address;
+	}
+
+	/**
+	 * @brief Set the interface for outgoing SSDP multicasts
+	 * @param address Interface address; if unset, revert to the station interface
+	 */
+	void selectMulticastInterface(IpAddress address);
+
+	void scheduleAdvertisement();
+	void advertise();
+	void indexDevice(Device& device);
+	void unindexDevice(Device& device);
+	void addRoute(Object& object, Object::UrlType type);
+	void beginSoapRequest(HttpServerConnection& connection, HttpRequest& request);
+	int findSoapRequest(const HttpServerConnection& connection) const;
+	void discardSoapRequests(const Service& service);
+
+	/*
+	 * Searches for a specific type or UDN across all devices are answered from the index
+	 */
+	static bool isIndexedSearch(const MessageSpec& ms, Device* device)
+	{
+		return device == nullptr && (ms.target() == SearchTarget::type || ms.target() == SearchTarget::uuid);
+	}
+
+	void joinSsdpGroup(IpAddress address);
+	void leaveSsdpGroups();
 
 	Device::List devices_;
+	ObjectIndex routes;     ///< URL path -> Object, tag contains UrlType
+	ObjectIndex targets;    ///< Search target -> Object, tag contains SearchMatch
+	LinkedItemList cursors; ///< Active search requests and notifications
+	SearchLimiter searchLimiter_;
+	Vector<Interface> interfaces; ///< Additional interfaces, e.g. Ethernet
+	Vector<IpAddress> ssdpGroups; ///< Interfaces on which we've joined the SSDP multicast group
+	Vector<PortServer> servers;
+	Vector<SoapRequest> soapRequests;
+	Vector<PendingRemoval> pendingRemovals;
+	Vector<StatusStream*> statusStreams; ///< Streams being read, updated when devices are removed
+	IpAddress activeAddress; ///< Interface address for current request or message
+	bool useStation{true};
+	bool useAccessPoint{false};
+	Timer advertTimer;
+	unsigned advertIndex{0}; ///< Next root device to advertise
+	uint32_t maxAge_{1800};
+	uint32_t bootId_{0};
+	uint32_t minFreeHeap_{UINT32_MAX};
+	size_t maxArgSize_{UPNP_MAX_ARG_SIZE};
+	unsigned pendingMessages{0};
+	unsigned maxQueuedMessages{128};
 };
 
 extern DeviceHost deviceHost;
@@ -32,7 +32,9 @@
 	XX(BadSoapFault, "Unknown SOAP fault kind")                                                                        \
 	XX(BadSoapNamespace, "Bad SOAP namespace attribute")                                                               \
 	XX(ActionInvalid, "Action name not recognised")                                                                    \
-	XX(ActionNotImplemented, "Action not implemented")
+	XX(ActionArgsInvalid, "Action arguments missing or invalid")                                                       \
+	XX(ActionNotImplemented, "Action not implemented")                                                                 \
+	XX(ArgumentTooLong, "Argument value exceeds maximum size")
 
 namespace UPnP
 {
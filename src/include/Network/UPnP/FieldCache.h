@@ -0,0 +1,96 @@
+/****
+ * FieldCache.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <WString.h>
+#include <IpAddress.h>
+#include <Delegate.h>
+#include <WVector.h>
+
+namespace UPnP
+{
+/**
+ * @brief Stores a snapshot of an object's field values
+ *
+ * Values are computed once, typically when a device is registered, and handed out as `const char*`.
+ * Some fields contain the local IP address, so a separate set of values is kept for each interface address.
+ */
+class FieldCache
+{
+public:
+	using GetValue = Delegate<String(unsigned index)>;
+
+	/**
+	 * @brief Maximum number of addresses to cache values for
+	 *
+	 * When exceeded the oldest set of values is discarded, so stale addresses don't accumulate.
+	 */
+	static constexpr unsigned maxEntries{4};
+
+	bool isEnabled() const
+	{
+		return enabled;
+	}
+
+	void enable(bool state)
+	{
+		enabled = state;
+		if(!state) {
+			clear();
+		}
+	}
+
+	/**
+	 * @brief Fetch and store all values for a local IP address
+	 * @param count Number of values
+	 * @param getValue Called for each value
+	 * @param address Local IP address used to construct values
+	 * @retval bool false on memory allocation failure
+	 */
+	bool build(unsigned count, GetValue getValue, IpAddress address);
+
+	/**
+	 * @brief Discard all cached values
+	 */
+	void clear()
+	{
+		entries.clear();
+	}
+
+	/**
+	 * @brief Get a cached value
+	 * @param address Local IP address
+	 * @param index Value index
+	 * @retval const char* nullptr if there are no values for this address, or index out of range
+	 */
+	const char* get(IpAddress address, unsigned index) const;
+
+private:
+	struct Entry {
+		IpAddress address;
+		String data; ///< Value offsets (uint16_t[count]) followed by NUL-terminated values
+	};
+
+	Vector<Entry> entries;
+	uint16_t count{0};
+	bool enabled{false};
+};
+
+} // namespace UPnP
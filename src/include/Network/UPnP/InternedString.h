@@ -0,0 +1,97 @@
+/****
+ * InternedString.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <WString.h>
+
+namespace UPnP
+{
+/**
+ * @brief Reference-counted string stored in a global table
+ *
+ * Values such as manufacturer and model names are generally shared by many devices.
+ * Each unique value is stored once, so memory use grows with the number of distinct values
+ * rather than the number of objects.
+ *
+ * Values are immutable; assignment replaces the reference.
+ */
+class InternedString
+{
+public:
+	struct Entry; ///< Opaque table entry
+
+	struct Stats {
+		unsigned count;      ///< Number of unique strings
+		unsigned references; ///< Total number of references to those strings
+		size_t size;         ///< Total size of string data, including NUL terminators
+	};
+
+	InternedString() = default;
+
+	InternedString(const String& value)
+	{
+		*this = value;
+	}
+
+	InternedString(const InternedString& other) : entry(other.entry)
+	{
+		addRef();
+	}
+
+	~InternedString()
+	{
+		release();
+	}
+
+	InternedString& operator=(const String& value);
+
+	InternedString& operator=(const InternedString& other);
+
+	const char* c_str() const;
+
+	size_t length() const;
+
+	/**
+	 * @brief Get value as a String
+	 * @retval String Invalid (nullptr) if not set, as for a String field which was never assigned
+	 */
+	operator String() const
+	{
+		return entry ? String(c_str(), length()) : nullptr;
+	}
+
+	bool operator==(const InternedString& other) const
+	{
+		return entry == other.entry;
+	}
+
+	/**
+	 * @brief Get usage information for the string table
+	 */
+	static Stats stats();
+
+private:
+	void addRef();
+	void release();
+
+	Entry* entry{nullptr};
+};
+
+} // namespace UPnP
@@ -31,6 +31,20 @@ class LinkedItemList;
 class LinkedItem : public Item
 {
 public:
+	LinkedItem() = default;
+
+	/*
+	 * A copy is not a member of any list
+	 */
+	LinkedItem(const LinkedItem&)
+	{
+	}
+
+	LinkedItem& operator=(const LinkedItem&)
+	{
+		return *this;
+	}
+
 	LinkedItem* next() const override
 	{
 		return next_;
@@ -44,6 +58,8 @@ public:
 private:
 	friend class LinkedItemList;
 	LinkedItem* next_{nullptr};
+	LinkedItem* prev_{nullptr};
+	LinkedItemList* list_{nullptr}; ///< List containing this item
 };
 
 } // namespace UPnP
@@ -24,12 +24,21 @@
 namespace UPnP
 {
 /**
- * @brief Singly-linked list of items
- * @note We don't own the items, just keep references to them
+ * @brief Doubly-linked list of items
+ * @note We don't own the items, just keep references to them.
+ * The destructor doesn't touch them either, as they may already have been destroyed.
+ *
+ * Items record which list they belong to, so adding, removing and membership tests
+ * take constant time. An item may only be in one list at a time: adding it to
+ * a second list removes it from the first.
  */
 class LinkedItemList
 {
 public:
+	/**
+	 * @brief Append an item to the list
+	 * @retval bool true if item is now in the list, false if item is null
+	 */
 	bool add(LinkedItem* item);
 
 	bool add(const LinkedItem* item)
@@ -39,10 +48,7 @@ public:
 
 	bool remove(LinkedItem* item);
 
-	void clear()
-	{
-		head_ = nullptr;
-	}
+	void clear();
 
 	LinkedItem* head()
 	{
@@ -54,27 +60,40 @@ public:
 		return head_;
 	}
 
+	LinkedItem* tail()
+	{
+		return tail_;
+	}
+
+	const LinkedItem* tail() const
+	{
+		return tail_;
+	}
+
 	LinkedItem* find(LinkedItem* item)
 	{
-		auto p = head_;
-		while(p != nullptr && p != item) {
-			p = p->next();
-		}
-		return p;
+		return contains(item) ? item : nullptr;
 	}
 
 	const LinkedItem* find(LinkedItem* item) const
 	{
-		return const_cast<LinkedItemList*>(this)->find(item);
+		return contains(item) ? item : nullptr;
+	}
+
+	bool contains(const LinkedItem* item) const
+	{
+		return item != nullptr && item->list_ == this;
 	}
 
-	bool contains(LinkedItem* item) const
+	unsigned count() const
 	{
-		return find(item) != nullptr;
+		return count_;
 	}
 
 private:
 	LinkedItem* head_{nullptr};
+	LinkedItem* tail_{nullptr};
+	unsigned count_{0};
 };
 
 } // namespace UPnP
@@ -0,0 +1,172 @@
+/****
+ * Metrics.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ErrorCode.h"
+#include <WString.h>
+#include <WVector.h>
+#include <Print.h>
+
+#ifndef UPNP_ENABLE_METRICS
+#define UPNP_ENABLE_METRICS 0
+#endif
+
+/**
+ * @brief Record a metric
+ * @param call Metrics method call, e.g. `UPNP_METRIC(countSsdpReceived())`
+ * @note Arguments are not evaluated unless metrics are enabled
+ */
+#if UPNP_ENABLE_METRICS
+#define UPNP_METRIC(call) UPnP::metrics.call
+#else
+#define UPNP_METRIC(call) (void)0
+#endif
+
+#if UPNP_ENABLE_METRICS
+
+namespace UPnP
+{
+class Service;
+struct ObjectClass;
+
+/**
+ * @brief Counters and timing histograms for the main processing paths
+ *
+ * Only available when built with `UPNP_ENABLE_METRICS=1`.
+ * Timings are in microseconds.
+ */
+class Metrics
+{
+public:
+	/**
+	 * @brief Distribution of values in power-of-two buckets
+	 *
+	 * Bucket `n` counts values which require `n` bits, so bucket 0 counts zero values,
+	 * bucket 1 counts 1, bucket 2 counts 2-3, etc. The final bucket also counts anything larger.
+	 */
+	struct Histogram {
+		static constexpr unsigned bucketCount{21};
+
+		uint32_t count;
+		uint32_t min;
+		uint32_t max;
+		uint64_t total;
+		uint32_t buckets[bucketCount];
+
+		void add(uint32_t value);
+
+		uint32_t average() const
+		{
+			return count ? total / count : 0;
+		}
+
+		/**
+		 * @brief Print as JSON object
+		 */
+		size_t printTo(Print& p) const;
+	};
+
+	/**
+	 * @brief Statistics for one action of a service type
+	 */
+	struct Action {
+		const ObjectClass* cls; ///< Service class
+		String name;            ///< Unset for the entry counting unknown actions
+		Histogram latency;
+		uint32_t faultCount;
+		ErrorCode lastFault;
+	};
+
+	/**
+	 * @brief Maximum number of distinct actions tracked
+	 */
+	static constexpr unsigned maxActions{32};
+
+	uint32_t ssdpReceived;       ///< SSDP messages received
+	uint32_t ssdpSent;           ///< SSDP messages sent
+	uint32_t searchesAnswered;   ///< M-SEARCH requests accepted for response
+	uint32_t descriptionsServed; ///< Description and SCPD requests handled
+	uint32_t fetchBytes;         ///< Total size of descriptions fetched by control points
+	Histogram fetchLatency;      ///< Time from request to completion of description fetches
+	uint32_t minFreeHeap;        ///< Lowest free heap seen when recording
+	uint32_t startTime;          ///< millis() at last reset
+
+	Metrics()
+	{
+		reset();
+	}
+
+	void reset();
+
+	void countSsdpReceived()
+	{
+		++ssdpReceived;
+		checkHeap();
+	}
+
+	void countSsdpSent()
+	{
+		++ssdpSent;
+	}
+
+	void countSearchAnswered()
+	{
+		++searchesAnswered;
+	}
+
+	void countDescriptionServed()
+	{
+		++descriptionsServed;
+		checkHeap();
+	}
+
+	void recordDescriptionFetch(size_t size, uint32_t latency);
+
+	/**
+	 * @brief Record completion of an action request
+	 * @param service Service which handled the action
+	 * @param actionName
+	 * @param latency Time from receipt of request to completion
+	 * @param fault Error code returned to the client, or ErrorCode::None on success
+	 * @note Actions the service didn't recognise are counted together, so clients can't fill the table
+	 */
+	void recordAction(const Service& service, const String& actionName, uint32_t latency, ErrorCode fault);
+
+	const Vector<Action>& actions() const
+	{
+		return actions_;
+	}
+
+	/**
+	 * @brief Print all metrics as a JSON object
+	 */
+	size_t printTo(Print& p) const;
+
+private:
+	void checkHeap();
+
+	Vector<Action> actions_;
+};
+
+extern Metrics metrics;
+
+} // namespace UPnP
+
+#endif // UPNP_ENABLE_METRICS
@@ -0,0 +1,188 @@
+/****
+ * MulticastEvent.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Network/UdpConnection.h>
+#include <WVector.h>
+#include <Delegate.h>
+#include <RapidXML.h>
+
+#define UPNP_EVENT_LEVEL_MAP(XX)                                                                                       \
+	XX(emergency)                                                                                                      \
+	XX(fault)                                                                                                          \
+	XX(warning)                                                                                                        \
+	XX(info)                                                                                                           \
+	XX(debug)                                                                                                          \
+	XX(general)
+
+namespace UPnP
+{
+class Service;
+class ServiceControl;
+
+/**
+ * @brief UPnP 2.0 multicast eventing
+ *
+ * State variables marked as `multicast` in the service description may be published
+ * with a single UDP datagram instead of a unicast NOTIFY to every subscriber.
+ */
+namespace MulticastEvent
+{
+/**
+ * @brief Importance of an event, sent in the LVL header as `upnp:/{level}`
+ */
+enum class Level {
+#define XX(name) name,
+	UPNP_EVENT_LEVEL_MAP(XX)
+#undef XX
+};
+
+extern const IpAddress multicastIp; ///< 239.255.255.246
+constexpr uint16_t multicastPort{7900};
+
+/**
+ * @brief Set of changed state variables carried in the body of an event message
+ */
+class PropertySet
+{
+public:
+	PropertySet();
+
+	/**
+	 * @brief Load a received `propertyset` document
+	 * @param content MUST remain valid for the lifetime of this object
+	 */
+	bool load(String&& content);
+
+	void add(const String& name, const String& value);
+
+	template <typename T> void add(const String& name, T value)
+	{
+		add(name, String(value));
+	}
+
+	/**
+	 * @brief Get the value for a state variable
+	 * @retval const char* nullptr if variable not present
+	 */
+	const char* getValue(const String& name) const;
+
+	/**
+	 * @brief Get the state variable node at the given position
+	 * @retval XML::Node* nullptr if index is out of range
+	 */
+	XML::Node* getProperty(unsigned index) const;
+
+	bool isEmpty() const
+	{
+		return getProperty(0) == nullptr;
+	}
+
+	String serialize() const
+	{
+		return XML::serialize(doc);
+	}
+
+private:
+	XML::Document doc;
+	XML::Node* root{nullptr};
+	String buffer;
+};
+
+/**
+ * @brief Received event information
+ */
+struct Event {
+	Level level;
+	uint32_t seq; ///< Sequence number as supplied by the publisher
+	PropertySet properties;
+};
+
+/**
+ * @brief Manages the UDP socket used to publish and receive multicast events
+ */
+class Server : private UdpConnection
+{
+public:
+	using Callback = Delegate<void(ServiceControl& service, const Event& event)>;
+
+	Server();
+
+	/**
+	 * @brief Join the multicast group on each DeviceHost interface and start listening
+	 * @note Called automatically when publishing or registering a listener.
+	 * Interfaces added afterwards are not joined until the server is restarted.
+	 */
+	bool begin();
+
+	void end();
+
+	bool isActive() const
+	{
+		return active;
+	}
+
+	/**
+	 * @brief Send an event for a hosted service on every joined interface
+	 * @param service The publishing service
+	 * @param seq Event sequence number
+	 * @param properties Changed state variables
+	 * @param level Importance of this event
+	 * @retval bool true on success
+	 */
+	bool publish(const Service& service, uint32_t seq, const PropertySet& properties, Level level);
+
+	/**
+	 * @brief Register a callback to be invoked for events published by a remote service
+	 * @note Any existing callback for the service is replaced
+	 */
+	bool addListener(ServiceControl& service, Callback callback);
+
+	bool removeListener(ServiceControl& service);
+
+private:
+	struct Listener {
+		ServiceControl* service;
+		Callback callback;
+
+		bool operator==(const Listener& other) const
+		{
+			return service == other.service;
+		}
+	};
+
+	int findListener(ServiceControl& service) const;
+	void leaveGroups();
+	void onReceive(char* data, int size, IpAddress remoteIP, uint16_t remotePort);
+
+	Vector<Listener> listeners;
+	Vector<IpAddress> groups; ///< Interface addresses on which the multicast group was joined
+	bool active{false};
+};
+
+extern Server server;
+
+} // namespace MulticastEvent
+
+} // namespace UPnP
+
+String toString(UPnP::MulticastEvent::Level level);
+
+bool fromString(const char* value, UPnP::MulticastEvent::Level& level);
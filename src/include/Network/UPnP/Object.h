@@ -39,6 +39,17 @@ class Object : public BaseObject
 public:
 	using Version = ObjectClass::Version;
 
+	/**
+	 * @brief Identifies the URLs an object serves
+	 */
+	enum class UrlType {
+		presentation, ///< Device presentation page (root device only)
+		description,  ///< Device description or service SCPD
+		control,      ///< Service control
+		eventSub,     ///< Service event subscription
+		MAX
+	};
+
 	virtual const ObjectClass& getClass() const = 0;
 
 	Object* getNext() const
@@ -88,6 +99,28 @@ public:
 		return false;
 	}
 
+	/**
+	 * @brief Get the absolute path for a URL served by this object
+	 * @param type
+	 * @retval String Empty if this object does not serve the given URL type
+	 * @note Used to build the routing table when a device is registered
+	 */
+	virtual String getUrlPath(UrlType type) const
+	{
+		return nullptr;
+	}
+
+	/**
+	 * @brief Called by framework to handle an incoming HTTP request for a known URL
+	 * @param connection
+	 * @param type Identifies the URL which was matched
+	 * @retval bool true if request was handled
+	 */
+	virtual bool handleUrlRequest(HttpServerConnection& connection, UrlType type)
+	{
+		return false;
+	}
+
 	/**
 	 * @brief Called by framework to construct a device description response stream
 	 * @retval IDataSourceStream* The XML description content
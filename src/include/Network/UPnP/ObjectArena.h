@@ -0,0 +1,159 @@
+/****
+ * ObjectArena.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <WString.h>
+#include <cstddef>
+
+namespace UPnP
+{
+/**
+ * @brief Block allocator for control point object trees
+ *
+ * When a device description is parsed, the objects for the entire tree and their strings
+ * may be allocated from a single arena instead of individually from the heap.
+ * Objects are destroyed as normal, but memory is only returned to the heap once the
+ * final allocation has been released, i.e. when the root device is deleted.
+ *
+ * Allocations made via `allocate()` come from the current arena, as set using `Scope`.
+ * If there isn't one then the regular heap is used.
+ */
+class ObjectArena
+{
+public:
+	/**
+	 * @brief Make an arena current for the lifetime of this object
+	 */
+	class Scope
+	{
+	public:
+		Scope(ObjectArena* arena) : previous(current)
+		{
+			current = arena;
+		}
+
+		~Scope()
+		{
+			current = previous;
+		}
+
+	private:
+		ObjectArena* previous;
+	};
+
+	/**
+	 * @brief Create a new arena
+	 * @param blockSize Size of each block, allocated when required
+	 * @retval ObjectArena* The caller holds a reference, which must be dropped using `release()`
+	 */
+	static ObjectArena* create(size_t blockSize);
+
+	/**
+	 * @brief Drop the reference obtained via `create()`
+	 *
+	 * The arena is destroyed once any outstanding allocations have been freed.
+	 */
+	void release();
+
+	/**
+	 * @brief Allocate memory from the current arena, or the heap if there isn't one
+	 */
+	static void* allocate(size_t size);
+
+	/**
+	 * @brief Free memory obtained via `allocate()`
+	 */
+	static void free(void* ptr);
+
+	/**
+	 * @brief Total size of blocks allocated from the heap
+	 */
+	size_t capacity() const;
+
+	/**
+	 * @brief Get size of all allocations made from this arena
+	 */
+	size_t used() const;
+
+private:
+	struct Block {
+		Block* next;
+		size_t size;
+		size_t used;
+	};
+
+	ObjectArena(size_t blockSize) : blockSize(blockSize)
+	{
+	}
+
+	~ObjectArena();
+
+	void* alloc(size_t size);
+	void unref();
+
+	static ObjectArena* current;
+	Block* blocks{nullptr};
+	size_t blockSize;
+	unsigned refCount{1}; ///< Creator reference plus one for each live allocation
+};
+
+/**
+ * @brief Immutable string allocated via ObjectArena
+ */
+class ArenaString
+{
+public:
+	ArenaString() = default;
+	ArenaString(const ArenaString&) = delete;
+
+	ArenaString(const String& s)
+	{
+		*this = s;
+	}
+
+	~ArenaString()
+	{
+		ObjectArena::free(value);
+	}
+
+	ArenaString& operator=(const ArenaString&) = delete;
+
+	ArenaString& operator=(const String& s);
+
+	const char* c_str() const
+	{
+		return value ?: "";
+	}
+
+	size_t length() const
+	{
+		return value ? strlen(value) : 0;
+	}
+
+	operator String() const
+	{
+		return String(value);
+	}
+
+private:
+	char* value{nullptr};
+};
+
+} // namespace UPnP
@@ -68,6 +68,11 @@ struct ObjectClass {
 	struct Service {
 		const FlashString* serviceId;
 		const FlashString* schema;
+		/*
+		 * Optional list of state variables which are published via multicast events.
+		 * Must remain the last member so existing positional initializers still compile.
+		 */
+		const FSTR::Vector<FlashString>* multicastVariables{nullptr};
 	};
 
 	Kind kind_;
@@ -132,6 +137,15 @@ struct ObjectClass {
 	}
 
 	Urn objectType() const;
+
+	/**
+	 * @brief Get hash of kind, domain, type and version
+	 * @note Used to index registered classes. Reads the class strings from flash so not cached.
+	 */
+	uint32_t hash() const;
+
+	static uint32_t hash(Kind kind, const String& domain, const String& type, Version version);
+
 	bool operator==(const ObjectClass& other) const;
 	bool typeIs(const Urn& objectType) const;
 	bool typeIs(Urn::Kind kind, const String& type, uint8_t version) const;
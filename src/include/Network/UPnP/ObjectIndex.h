@@ -0,0 +1,99 @@
+/****
+ * ObjectIndex.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <WString.h>
+#include <memory>
+
+namespace UPnP
+{
+class Object;
+
+/**
+ * @brief Hash table mapping string keys to objects
+ *
+ * Used to locate objects by URL path, type, etc. without walking the device tree.
+ * Keys are not required to be unique: use `findNext()` to enumerate all entries for a key.
+ */
+class ObjectIndex
+{
+public:
+	struct Entry {
+		Entry* next;
+		Object* object;
+		uint32_t hash;
+		uint8_t tag; ///< Application-defined value, e.g. URL type
+		String key;
+	};
+
+	~ObjectIndex()
+	{
+		clear();
+	}
+
+	/**
+	 * @brief Add an entry
+	 * @param key
+	 * @param object Object to associate with key
+	 * @param tag Additional value stored with entry
+	 * @retval bool false if key is empty
+	 */
+	bool add(const String& key, Object* object, uint8_t tag = 0);
+
+	/**
+	 * @brief Find first entry for a key
+	 * @retval const Entry* nullptr if not found
+	 */
+	const Entry* find(const char* key, size_t length) const;
+
+	const Entry* find(const String& key) const
+	{
+		return find(key.c_str(), key.length());
+	}
+
+	/**
+	 * @brief Find next entry with the same key
+	 */
+	const Entry* findNext(const Entry* entry) const;
+
+	/**
+	 * @brief Remove all entries for an object
+	 * @retval unsigned Number of entries removed
+	 */
+	unsigned remove(const Object* object);
+
+	void clear();
+
+	unsigned count() const
+	{
+		return entryCount;
+	}
+
+	static uint32_t hash(const char* key, size_t length);
+
+private:
+	void grow();
+
+	std::unique_ptr<Entry*[]> buckets;
+	unsigned bucketCount{0};
+	unsigned entryCount{0};
+};
+
+} // namespace UPnP
@@ -25,7 +25,7 @@
 namespace UPnP
 {
 /**
- * @brief Class template for singly-linked list of objects
+ * @brief Class template for linked list of objects
  * @note We don't own the objects, just keep references to them
  */
 template <typename ObjectType> class ObjectList : public LinkedItemList
@@ -56,15 +56,6 @@ public:
 		return head() == nullptr;
 	}
 
-	size_t count() const
-	{
-		size_t n{0};
-		for(auto it = begin(); it != end(); it++) {
-			++n;
-		}
-		return n;
-	}
-
 	/**
 	 * @brief Search list for matching entry
 	 * @tparam Urn or String
@@ -93,12 +84,17 @@ public:
 };
 
 /**
- * @brief Class template for singly-linked list of objects
+ * @brief Class template for linked list of objects
  * @note We own the objects so are responsible for destroying them when removed
  */
 template <typename ObjectType> class OwnedObjectList : public ObjectList<ObjectType>
 {
 public:
+	~OwnedObjectList()
+	{
+		clear();
+	}
+
 	bool remove(ObjectType* object)
 	{
 		bool res = LinkedItemList::remove(object);
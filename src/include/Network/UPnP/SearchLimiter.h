@@ -0,0 +1,100 @@
+/****
+ * SearchLimiter.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <IpAddress.h>
+#include <algorithm>
+
+namespace UPnP
+{
+/**
+ * @brief Counters for M-SEARCH requests handled by the device host
+ */
+struct SearchStats {
+	uint32_t received;         ///< Total M-SEARCH requests received
+	uint32_t invalid;          ///< Requests with missing or invalid fields
+	uint32_t rateLimited;      ///< Requests dropped because source exceeded its rate limit
+	uint32_t untracked;        ///< Requests from sources charged to the shared bucket as the table was full
+	uint32_t duplicates;       ///< Requests dropped as repeat of a query still being answered
+	uint32_t responsesQueued;  ///< Responses scheduled for sending
+	uint32_t responsesDropped; ///< Responses dropped because too many messages were pending
+};
+
+/**
+ * @brief Limits the rate at which M-SEARCH requests are answered for each source IP address
+ *
+ * Each source gets a token bucket which refills at a fixed rate up to a maximum burst size.
+ * Only a small number of sources are tracked. An entry is only replaced once its bucket has refilled,
+ * as a new source would start with a full bucket anyway. When no entry can be replaced, new sources
+ * share a single fallback bucket, so cycling through addresses doesn't earn extra bursts.
+ */
+class SearchLimiter
+{
+public:
+	static constexpr unsigned maxSources{8};
+
+	/**
+	 * @brief Set rate limit
+	 * @param queriesPerMinute Sustained rate at which queries are accepted from one source
+	 * @param burst Number of queries accepted in quick succession
+	 * @note Setting queriesPerMinute to 0 disables rate limiting.
+	 * Values are limited to 65535 queries per minute and a burst of 255.
+	 */
+	void setRate(unsigned queriesPerMinute, unsigned burst)
+	{
+		this->queriesPerMinute = std::min(queriesPerMinute, unsigned(UINT16_MAX));
+		this->burst = std::min(burst, unsigned(UINT8_MAX));
+		reset();
+	}
+
+	/**
+	 * @brief Determine whether a query from the given source should be answered
+	 * @retval bool false if rate exceeded
+	 */
+	bool accept(IpAddress source);
+
+	/**
+	 * @brief Forget all sources
+	 */
+	void reset()
+	{
+		memset(sources, 0, sizeof(sources));
+		fallback = Source{};
+	}
+
+	SearchStats stats{};
+
+private:
+	struct Source {
+		uint32_t ip;
+		uint32_t lastTime; ///< millis() at last refill
+		uint32_t tokens;   ///< In thousandths of a query
+	};
+
+	void refill(Source& src, uint32_t now);
+	bool take(Source& src);
+
+	Source sources[maxSources]{};
+	Source fallback{}; ///< Shared by sources which couldn't be given an entry
+	uint16_t queriesPerMinute{12};
+	uint8_t burst{8};
+};
+
+} // namespace UPnP
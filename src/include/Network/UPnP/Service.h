@@ -23,6 +23,8 @@
 #include "ObjectList.h"
 #include "ActionRequest.h"
 #include "Constants.h"
+#include "MulticastEvent.h"
+#include "FieldCache.h"
 #include <Network/SSDP/Urn.h>
 
 #define UPNP_SERVICE_FIELD_MAP(XX)                                                                                     \
@@ -77,9 +79,45 @@ public:
 	bool formatMessage(Message& msg, MessageSpec& ms) override;
 
 	bool onHttpRequest(HttpServerConnection& connection) override;
+	String getUrlPath(UrlType type) const override;
+	bool handleUrlRequest(HttpServerConnection& connection, UrlType type) override;
 
 	virtual String getField(Field desc) const;
 
+	/**
+	 * @brief Enable caching of field values
+	 * @note Usually called via `Device::enableFieldCache()`
+	 */
+	void enableFieldCache(bool enable = true)
+	{
+		fieldCache_.enable(enable);
+	}
+
+	void updateFieldCache();
+
+	/**
+	 * @brief Get a cached field value for the current local address
+	 * @retval const char* nullptr if caching is not enabled
+	 */
+	const char* getCachedField(Field desc) const
+	{
+		return getCachedValue(unsigned(desc));
+	}
+
+	/**
+	 * @brief Get a field value, using the cache if enabled
+	 */
+	String fieldValue(Field desc) const
+	{
+		auto s = getCachedField(desc);
+		return s ? String(s) : getField(desc);
+	}
+
+	/**
+	 * @brief Get the fully-qualified SCPD URL, as sent in the SSDP LOCATION header
+	 */
+	String getLocation() const;
+
 	Urn objectType() const override
 	{
 		return ServiceUrn(getField(Field::domain), getField(Field::type), version());
@@ -99,6 +137,11 @@ public:
 		return device_;
 	}
 
+	/**
+	 * @brief Get number of event subscriptions which have not been cancelled or expired
+	 */
+	unsigned subscriptionCount() const;
+
 	/**
 	 * @brief Implemented in ServiceControl
 	 */
@@ -130,12 +173,72 @@ public:
 	 * 		return ErrorCode::InvalidAction;
 	 *
 	 * This is usually handled by generated wrapper class templates.
+	 * Services with many actions should use an ActionDispatch::Table.
 	 *
 	 */
 	virtual Error handleAction(ActionRequest& req) = 0;
 
+	/**
+	 * @brief Determine whether a state variable may be published via multicast events
+	 * @param name Name of the state variable
+	 * @retval bool
+	 *
+	 * Default implementation checks the `multicastVariables` list in the service class information.
+	 */
+	virtual bool isMulticastVariable(const String& name) const;
+
+	/**
+	 * @brief Publish changed state variables using a UPnP 2.0 multicast event
+	 * @param properties Contains one or more changed state variables
+	 * @param level Importance of this event
+	 * @retval bool true on success
+	 * @note Only variables marked as multicast should be included
+	 */
+	bool sendMulticastEvent(const MulticastEvent::PropertySet& properties,
+							MulticastEvent::Level level = MulticastEvent::Level::info);
+
+	/**
+	 * @brief Publish a single changed state variable
+	 */
+	template <typename T>
+	bool sendMulticastEvent(const String& name, T value, MulticastEvent::Level level = MulticastEvent::Level::info)
+	{
+		MulticastEvent::PropertySet properties;
+		properties.add(name, value);
+		return sendMulticastEvent(properties, level);
+	}
+
 private:
+	// Values cached in addition to fields
+	enum CacheIndex {
+		cacheLocation = unsigned(Field::MAX),
+		cacheUsn,
+		cacheCount,
+	};
+
+	String getCacheValue(unsigned index) const;
+	const char* getCachedValue(unsigned index) const;
+
+	struct Subscription {
+		String sid;      ///< "uuid:..."
+		uint32_t expiry; ///< millis() at which subscription lapses unless renewed
+
+		bool operator==(const Subscription& other) const
+		{
+			return sid == other.sid;
+		}
+	};
+
+	static constexpr unsigned maxSubscriptionTimeout{1800}; ///< Seconds
+	static constexpr unsigned maxSubscriptions{8};
+
+	static unsigned getSubscriptionTimeout(const String& value);
+	void expireSubscriptions();
+
 	Device& device_;
+	mutable FieldCache fieldCache_;
+	Vector<Subscription> subscriptions_;
+	uint32_t eventSeq_{0}; ///< Multicast event sequence number
 	// actionList
 	// serviceStateTable
 };
@@ -20,7 +20,8 @@
 #pragma once
 
 #include "Service.h"
-#include <Data/CString.h>
+#include "ObjectArena.h"
+#include "InternedString.h"
 #include <memory>
 
 namespace UPnP
@@ -34,10 +35,13 @@ public:
 	using OwnedList = OwnedObjectList<ServiceControl>;
 	using Field = Service::Field;
 
+	/*
+	 * Paths are relative to the device base URL so are generally the same for every device of a given model
+	 */
 	struct Description {
-		CString controlURL;
-		CString eventSubURL;
-		CString serviceId;
+		InternedString controlURL;
+		InternedString eventSubURL;
+		InternedString serviceId;
 	};
 
 	ServiceControl() = delete;
@@ -47,6 +51,22 @@ public:
 	{
 	}
 
+	~ServiceControl();
+
+	/*
+	 * Objects are allocated from the current ObjectArena, if there is one.
+	 * A failed allocation yields nullptr rather than throwing, so callers must check.
+	 */
+	static void* operator new(size_t size) noexcept
+	{
+		return ObjectArena::allocate(size);
+	}
+
+	static void operator delete(void* ptr)
+	{
+		ObjectArena::free(ptr);
+	}
+
 	/**
 	 * @brief Get the root device
 	 */
@@ -84,6 +104,13 @@ public:
 		return reinterpret_cast<DeviceControl&>(Service::device());
 	}
 
+	/**
+	 * @brief Receive UPnP 2.0 multicast events published by this service
+	 * @param callback Invoked for each event received, pass nullptr to stop listening
+	 * @retval bool true on success
+	 */
+	bool onMulticastEvent(MulticastEvent::Server::Callback callback);
+
 	/**
 	 * @brief Get service description
 	 */
@@ -0,0 +1,101 @@
+/****
+ * StatusStream.h
+ *
+ * Copyright 2020 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the Sming UPnP Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Data/Stream/DataSourceStream.h>
+
+namespace UPnP
+{
+class DeviceHost;
+class Device;
+class Service;
+
+/**
+ * @brief Stream providing current state of the device host as a JSON document
+ *
+ * Content is generated one root device at a time as it is read, so the whole document is never held in memory.
+ * The document contains:
+ *
+ * - `devices`: Each registered device tree with its services
+ * - `ssdp`: Queue depth and search statistics
+ * - `metrics`: Counters, action latency and heap statistics, see Metrics. Only `enabled` if UPNP_ENABLE_METRICS=0.
+ * - `heap`: Current free heap, lowest free heap since `DeviceHost::begin()` and largest free block.
+ *   `maxBlock` is null where the platform doesn't provide it.
+ */
+class StatusStream : public IDataSourceStream
+{
+public:
+	StatusStream(DeviceHost& host);
+
+	~StatusStream();
+
+	bool isValid() const override
+	{
+		return true;
+	}
+
+	uint16_t readMemoryBlock(char* data, int bufSize) override;
+
+	bool seek(int len) override;
+
+	bool isFinished() override
+	{
+		return !content && (state == State::done);
+	}
+
+	MimeType getMimeType() const override
+	{
+		return MimeType::JSON;
+	}
+
+private:
+	friend DeviceHost;
+
+	/**
+	 * @brief Called by DeviceHost when a root device is unregistered
+	 * @param device The device, now removed from the list
+	 * @param next The device which followed it
+	 */
+	void deviceRemoved(Device& device, Device* next)
+	{
+		if(nextDevice == &device) {
+			nextDevice = next;
+		}
+	}
+
+	void getContent();
+	void addDevice(Device& device);
+	void addService(Service& service);
+	void addString(const String& value);
+
+	DeviceHost& host;
+	String content; // Buffer for current segment being output
+	Device* nextDevice{nullptr}; ///< Next root device to output
+	uint16_t readPos{0};
+	bool firstDevice{true};
+	enum class State {
+		header,
+		device,
+		footer,
+		done,
+	} state = State::header;
+};
+
+} // namespace UPnP
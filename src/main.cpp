@@ -17,33 +17,85 @@
  *
  ****/
 
+#include "main.h"
+#include "SsdpReceiver.h"
 #include "include/Network/UPnP/DeviceHost.h"
 #include "include/Network/UPnP/ControlPoint.h"
+#include "include/Network/UPnP/Metrics.h"
 #include <Network/SSDP/Server.h>
 
 namespace UPnP
 {
 static bool initialized;
 
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+static SsdpReceiver receiver;
+static bool threadedReceive;
+
+/*
+ * Multicast messages carry the SSDP group address in the HOST header.
+ * Unicast M-SEARCH requests carry the device address, and responses have none.
+ */
+static bool isMulticast(BasicMessage& msg)
+{
+	auto host = msg[HTTP_HEADER_HOST];
+	return host != nullptr && strncmp(host, "239.255.255.250", 15) == 0;
+}
+
+/*
+ * The threaded receiver only sees multicasts on interfaces where it joined the group
+ */
+static bool isThreadedReceive(BasicMessage& msg)
+{
+	if(!threadedReceive || !isMulticast(msg)) {
+		return false;
+	}
+	DeviceHost::Interface intf;
+	return deviceHost.findInterface(msg.remoteIP, intf) && receiver.isJoined(intf.address);
+}
+#endif
+
+void dispatchSsdpMessage(BasicMessage& msg)
+{
+	UPNP_METRIC(countSsdpReceived());
+
+	if(msg.type == MessageType::msearch) {
+		deviceHost.onSearchRequest(msg);
+	} else {
+		ControlPoint::onSsdpMessage(msg);
+	}
+}
+
 bool initialize()
 {
 	if(!initialized) {
 		initialized = SSDP::server.begin(
 			[](BasicMessage& msg) {
-				if(msg.type == MessageType::msearch) {
-					deviceHost.onSearchRequest(msg);
-				} else {
-					ControlPoint::onSsdpMessage(msg);
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+				// Multicast messages are handled by the threaded receiver, if it's running
+				if(isThreadedReceive(msg)) {
+					return;
 				}
+#endif
+				dispatchSsdpMessage(msg);
 			},
 			[](Message& msg, MessageSpec& ms) {
-				auto object = ms.object<Object>();
+				auto object = ms.object<BaseObject>();
 				if(object == nullptr) {
 					server.sendMessage(msg);
+					UPNP_METRIC(countSsdpSent());
 				} else {
 					object->sendMessage(msg, ms);
 				}
 			});
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+		if(initialized) {
+			threadedReceive = receiver.begin();
+			if(!threadedReceive) {
+				debug_e("[UPnP] Threaded SSDP receiver failed to start, receiving via SSDP server");
+			}
+		}
+#endif
 	}
 
 	return initialized;
@@ -52,7 +104,12 @@ bool initialize()
 void finalize()
 {
 	if(initialized) {
+#if defined(ARCH_HOST) && UPNP_THREADED_RECEIVE
+		receiver.end();
+		threadedReceive = false;
+#endif
 		SSDP::server.end();
+		MulticastEvent::server.end();
 		initialized = false;
 	}
 }
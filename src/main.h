@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <Network/SSDP/Message.h>
+
 namespace UPnP
 {
 /**
@@ -31,4 +33,9 @@ bool initialize();
  */
 void finalize();
 
+/**
+ * @brief Pass a received SSDP message to the control point or device host
+ */
+void dispatchSsdpMessage(SSDP::BasicMessage& msg);
+
 } // namespace UPnP
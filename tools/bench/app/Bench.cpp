@@ -0,0 +1,82 @@
+#include "Bench.h"
+#include <chrono>
+
+#if ENABLE_MALLOC_COUNT
+#include <malloc_count.h>
+#endif
+
+namespace Bench
+{
+namespace
+{
+constexpr unsigned nameWidth{40};
+constexpr unsigned columnWidth{12};
+
+Vector<Result> results;
+
+void printColumn(Print& p, String s)
+{
+	p.print(s.padLeft(columnWidth));
+}
+
+} // namespace
+
+Result run(const String& name, unsigned iterations, Function function)
+{
+	Result result;
+	result.name = name;
+	result.iterations = iterations;
+
+	function();
+
+#if ENABLE_MALLOC_COUNT
+	auto heapStart = MallocCount::getCurrent();
+	MallocCount::resetPeak();
+	MallocCount::resetTotal();
+	MallocCount::resetAllocCount();
+#endif
+
+	using Clock = std::chrono::steady_clock;
+	auto startTime = Clock::now();
+	for(unsigned i = 0; i < iterations; ++i) {
+		function();
+	}
+	auto elapsed = Clock::now() - startTime;
+	result.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+#if ENABLE_MALLOC_COUNT
+	result.allocCount = MallocCount::getAllocCount();
+	result.allocBytes = MallocCount::getTotal();
+	result.peakHeap = MallocCount::getPeak() - heapStart;
+#endif
+
+	results.add(result);
+	return result;
+}
+
+const Vector<Result>& getResults()
+{
+	return results;
+}
+
+void printHeader(Print& p)
+{
+	p.print(String(F("Benchmark")).padRight(nameWidth));
+	printColumn(p, F("ns/op"));
+	printColumn(p, F("allocs/op"));
+	printColumn(p, F("bytes/op"));
+	printColumn(p, F("peak heap"));
+	p.println();
+}
+
+void printResult(Print& p, const Result& result)
+{
+	p.print(String(result.name).padRight(nameWidth));
+	printColumn(p, String(result.nsPerOp()));
+	printColumn(p, String(result.allocsPerOp(), 1));
+	printColumn(p, String(result.bytesPerOp()));
+	printColumn(p, String(result.peakHeap));
+	p.println();
+}
+
+} // namespace Bench
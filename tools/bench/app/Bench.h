@@ -0,0 +1,139 @@
+#pragma once
+
+#include <WString.h>
+#include <Print.h>
+#include <Delegate.h>
+#include <WVector.h>
+
+/*
+ * Minimal benchmark framework for Host builds.
+ *
+ * Each benchmark is run once to warm up, so any one-off initialisation is excluded,
+ * then repeatedly whilst measuring elapsed time and heap activity via malloc_count.
+ */
+namespace Bench
+{
+using Function = Delegate<void()>;
+
+struct Result {
+	String name;
+	unsigned iterations{0};
+	uint64_t elapsedNs{0};
+	size_t allocCount{0}; ///< Total number of allocations
+	size_t allocBytes{0}; ///< Total bytes allocated
+	size_t peakHeap{0};   ///< Maximum heap in use above starting level
+
+	uint64_t nsPerOp() const
+	{
+		return iterations ? elapsedNs / iterations : 0;
+	}
+
+	float allocsPerOp() const
+	{
+		return iterations ? float(allocCount) / iterations : 0;
+	}
+
+	size_t bytesPerOp() const
+	{
+		return iterations ? allocBytes / iterations : 0;
+	}
+};
+
+/**
+ * @brief Run a benchmark
+ * @param name Identifies the benchmark in output
+ * @param iterations Number of times to call the function, excluding warm-up
+ * @param function The operation to measure
+ */
+Result run(const String& name, unsigned iterations, Function function);
+
+/**
+ * @brief Print table heading
+ */
+void printHeader(Print& p);
+
+/**
+ * @brief Print a single result as a table row
+ */
+void printResult(Print& p, const Result& result);
+
+/**
+ * @brief Output sink which discards everything written, but keeps count
+ */
+class NullPrint : public Print
+{
+public:
+	size_t write(uint8_t) override
+	{
+		++count;
+		return 1;
+	}
+
+	size_t write(const uint8_t*, size_t size) override
+	{
+		count += size;
+		return size;
+	}
+
+	size_t count{0};
+};
+
+/*
+ * Allocation budgets
+ *
+ * A budget file records the allocation figures for each benchmark, one per line:
+ *
+ * 	allocs/op,bytes/op,peak heap,name
+ *
+ * Results from later runs are checked against these to catch regressions.
+ */
+
+/**
+ * @brief Get all results obtained so far, in order
+ */
+const Vector<Result>& getResults();
+
+/**
+ * @brief Write allocation figures for all results to a budget file
+ * @retval bool true on success
+ */
+bool saveBudget(Print& p, const String& filename);
+
+/**
+ * @brief Check allocation figures for all results against a budget file
+ * @param p Report output
+ * @param filename Budget file to read
+ * @param tolerance Percentage by which figures may exceed their budget
+ * @retval int Number of benchmarks exceeding their budget, -1 if the file cannot be read
+ */
+int checkBudget(Print& p, const String& filename, unsigned tolerance);
+
+/*
+ * Benchmark suites
+ */
+
+/**
+ * @brief SOAP envelope parsing, dispatch and response serialization
+ * @param p Results output
+ * @param iterations Number of iterations for each benchmark
+ * @param itemCount Number of items in Browse results
+ */
+void envelope(Print& p, unsigned iterations, unsigned itemCount);
+
+/**
+ * @brief Description generation and parsing
+ * @param p Results output
+ * @param iterations Number of iterations for each benchmark
+ * @param width Number of services and embedded devices for each device in the synthetic tree
+ * @param depth Number of device levels in the synthetic tree
+ */
+void description(Print& p, unsigned iterations, unsigned width, unsigned depth);
+
+/**
+ * @brief SSDP search response and notification formatting
+ * @param p Results output
+ * @param iterations Number of iterations for each benchmark
+ */
+void ssdp(Print& p, unsigned iterations);
+
+} // namespace Bench
@@ -0,0 +1,190 @@
+#include "Bench.h"
+#include <Data/Stream/HostFileStream.h>
+
+namespace Bench
+{
+namespace
+{
+struct Budget {
+	String name;
+	unsigned allocs; ///< Allocations per operation, in tenths
+	size_t bytes;
+	size_t peak;
+};
+
+// Allocation counts are compared to one decimal place, as printed
+unsigned tenths(float value)
+{
+	return unsigned(value * 10 + 0.5);
+}
+
+bool parseLine(const String& line, Budget& budget)
+{
+	int pos[3];
+	int start{0};
+	for(unsigned i = 0; i < ARRAY_SIZE(pos); ++i) {
+		pos[i] = line.indexOf(',', start);
+		if(pos[i] < 0) {
+			return false;
+		}
+		start = pos[i] + 1;
+	}
+
+	auto s = line.c_str();
+	budget.allocs = tenths(atof(s));
+	budget.bytes = strtoul(s + pos[0] + 1, nullptr, 10);
+	budget.peak = strtoul(s + pos[1] + 1, nullptr, 10);
+	budget.name = line.substring(pos[2] + 1);
+	budget.name.trim();
+	return budget.name.length() != 0;
+}
+
+bool loadBudgets(const String& filename, Vector<Budget>& budgets)
+{
+	HostFileStream fs;
+	if(!fs.open(filename, File::ReadOnly)) {
+		return false;
+	}
+
+	String content = fs.readString(fs.available());
+	int start{0};
+	while(unsigned(start) < content.length()) {
+		int end = content.indexOf('\n', start);
+		if(end < 0) {
+			end = content.length();
+		}
+		String line = content.substring(start, end);
+		start = end + 1;
+		if(line.length() == 0 || line[0] == '#') {
+			continue;
+		}
+		Budget budget;
+		if(parseLine(line, budget)) {
+			budgets.add(budget);
+		}
+	}
+
+	return true;
+}
+
+int findBudget(const Vector<Budget>& budgets, const String& name)
+{
+	for(unsigned i = 0; i < budgets.count(); ++i) {
+		if(budgets[i].name == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+template <typename T> bool exceeds(T value, T budget, unsigned tolerance)
+{
+	return value * 100 > budget * (100 + tolerance);
+}
+
+void printExcess(Print& p, const String& what, const String& value, const String& budget)
+{
+	p.print(F("  "));
+	p.print(what);
+	p.print(' ');
+	p.print(value);
+	p.print(F(", budget "));
+	p.println(budget);
+}
+
+} // namespace
+
+bool saveBudget(Print& p, const String& filename)
+{
+	auto& results = getResults();
+	HostFileStream fs;
+	if(!fs.open(filename, File::CreateNewAlways | File::WriteOnly)) {
+		p.print(F("** Cannot create "));
+		p.println(filename);
+		return false;
+	}
+
+	fs.println(F("# allocs/op,bytes/op,peak heap,name"));
+	for(unsigned i = 0; i < results.count(); ++i) {
+		auto& result = results[i];
+		fs.print(String(result.allocsPerOp(), 1));
+		fs.print(',');
+		fs.print(result.bytesPerOp());
+		fs.print(',');
+		fs.print(result.peakHeap);
+		fs.print(',');
+		fs.println(result.name);
+	}
+
+	p.print(F("Budgets for "));
+	p.print(results.count());
+	p.print(F(" benchmarks written to "));
+	p.println(filename);
+	return true;
+}
+
+int checkBudget(Print& p, const String& filename, unsigned tolerance)
+{
+	auto& results = getResults();
+	Vector<Budget> budgets;
+	if(!loadBudgets(filename, budgets)) {
+		p.print(F("** Cannot read "));
+		p.print(filename);
+		p.println(F(", record one using --record-budget"));
+		return -1;
+	}
+
+	p.println();
+	p.print(F("Checking allocations against "));
+	p.print(filename);
+	p.print(F(", tolerance "));
+	p.print(tolerance);
+	p.println('%');
+
+	unsigned failCount{0};
+	unsigned missingCount{0};
+	for(unsigned i = 0; i < results.count(); ++i) {
+		auto& result = results[i];
+		int index = findBudget(budgets, result.name);
+		if(index < 0) {
+			p.print(F("NEW  "));
+			p.println(result.name);
+			++missingCount;
+			continue;
+		}
+
+		auto& budget = budgets[index];
+		auto allocs = tenths(result.allocsPerOp());
+		auto bytes = result.bytesPerOp();
+		bool allocsFail = exceeds(allocs, budget.allocs, tolerance);
+		bool bytesFail = exceeds(bytes, budget.bytes, tolerance);
+		bool peakFail = exceeds(result.peakHeap, budget.peak, tolerance);
+		if(!allocsFail && !bytesFail && !peakFail) {
+			continue;
+		}
+
+		++failCount;
+		p.print(F("FAIL "));
+		p.println(result.name);
+		if(allocsFail) {
+			printExcess(p, F("allocs/op"), String(allocs / 10.0, 1), String(budget.allocs / 10.0, 1));
+		}
+		if(bytesFail) {
+			printExcess(p, F("bytes/op"), String(bytes), String(budget.bytes));
+		}
+		if(peakFail) {
+			printExcess(p, F("peak heap"), String(result.peakHeap), String(budget.peak));
+		}
+	}
+
+	p.print(results.count() - missingCount);
+	p.print(F(" checked, "));
+	p.print(failCount);
+	p.print(F(" over budget, "));
+	p.print(missingCount);
+	p.println(F(" without budget"));
+
+	return failCount;
+}
+
+} // namespace Bench
@@ -0,0 +1,325 @@
+#include "Bench.h"
+#include <Network/UPnP/DeviceControl.h>
+#include <Network/UPnP/DescriptionStream.h>
+#include <Network/UPnP/ControlPoint.h>
+#include <Network/UPnP/schemas-upnp-org/ClassGroup.h>
+#include <Data/Stream/HostFileStream.h>
+#include <memory>
+
+// Parser is internal to the library
+#include "../../../src/DescriptionParser.h"
+
+/*
+ * Descriptions are generated from a synthetic tree of hosted devices and services,
+ * then parsed back using the same classes as control objects.
+ *
+ * Captured descriptions are parsed using the standard UPnP classes from UPnP-Schema.
+ */
+
+namespace UPnP
+{
+namespace
+{
+DEFINE_FSTR_LOCAL(domain_sming, "schemas-sming-org")
+DEFINE_FSTR_LOCAL(type_BenchDevice, "BenchDevice")
+DEFINE_FSTR_LOCAL(type_BenchService, "BenchService")
+DEFINE_FSTR_LOCAL(benchLocation, "http://192.168.1.10:80/BenchDevice/desc.xml")
+
+Object* createDeviceControl(DeviceControl* owner);
+Object* createServiceControl(DeviceControl* owner);
+
+const ObjectClass benchDeviceClass PROGMEM{
+	Urn::Kind::device, 1, &domain_sming, &type_BenchDevice, createDeviceControl, {},
+};
+const ObjectClass benchServiceClass PROGMEM{
+	Urn::Kind::service, 1, &domain_sming, &type_BenchService, createServiceControl, {},
+};
+
+DEFINE_FSTR_VECTOR_LOCAL(benchClasses, ObjectClass, &benchDeviceClass, &benchServiceClass)
+
+// Captured descriptions with standard root device types
+DEFINE_FSTR_LOCAL(capture_sony_hg1, "sony/hg1/ddd.xml")
+DEFINE_FSTR_LOCAL(capture_panasonic_dmr, "panasonic/viera/dmr/ddd.xml")
+DEFINE_FSTR_LOCAL(capture_panasonic_dms, "panasonic/viera/dms/ddd.xml")
+DEFINE_FSTR_VECTOR_LOCAL(captures, FlashString, &capture_sony_hg1, &capture_panasonic_dmr, &capture_panasonic_dms)
+
+constexpr unsigned chunkSizes[]{64, 256, 1460, 4096};
+constexpr size_t arenaBlockSize{4096};
+
+/*
+ * Hosted objects for generating descriptions
+ */
+class BenchDevice : public Device
+{
+public:
+	BenchDevice(unsigned id) : id(id)
+	{
+	}
+
+	BenchDevice(Device& parent, unsigned id) : Device(parent), id(id)
+	{
+	}
+
+	const ObjectClass& getClass() const override
+	{
+		return benchDeviceClass;
+	}
+
+	String getField(Field desc) const override
+	{
+		switch(desc) {
+		case Field::friendlyName: {
+			String s = F("Bench device #");
+			s += id;
+			return s;
+		}
+		case Field::manufacturer:
+			return F("Sming");
+		case Field::modelName:
+			return F("Benchmark");
+		case Field::modelNumber:
+			return F("1.0");
+		case Field::serialNumber:
+			return String(id);
+		case Field::UDN: {
+			String s = F("uuid:5d794fc2-5c5e-4460-a023-");
+			s += id;
+			return s;
+		}
+		default:
+			return Device::getField(desc);
+		}
+	}
+
+private:
+	unsigned id;
+};
+
+class BenchService : public Service
+{
+public:
+	BenchService(Device& device, unsigned id) : Service(device), id(id)
+	{
+	}
+
+	const ObjectClass& getClass() const override
+	{
+		return benchServiceClass;
+	}
+
+	String getField(Field desc) const override
+	{
+		switch(desc) {
+		case Field::serviceId: {
+			String s = F("urn:sming-org:serviceId:BenchService");
+			s += id;
+			return s;
+		}
+		default:
+			return Service::getField(desc);
+		}
+	}
+
+	Error handleAction(ActionRequest& req) override
+	{
+		return Error::ActionNotImplemented;
+	}
+
+private:
+	unsigned id;
+};
+
+/*
+ * Control objects created by the description parser
+ */
+class BenchDeviceControl : public DeviceControl
+{
+public:
+	BenchDeviceControl(DeviceControl* parent) : DeviceControl(parent)
+	{
+	}
+
+	const ObjectClass& getClass() const override
+	{
+		return benchDeviceClass;
+	}
+};
+
+class BenchServiceControl : public ServiceControl
+{
+public:
+	using ServiceControl::ServiceControl;
+
+	const ObjectClass& getClass() const override
+	{
+		return benchServiceClass;
+	}
+};
+
+Object* createDeviceControl(DeviceControl* owner)
+{
+	return new BenchDeviceControl(owner);
+}
+
+Object* createServiceControl(DeviceControl* owner)
+{
+	return new BenchServiceControl(*owner);
+}
+
+struct TreeStats {
+	unsigned deviceCount{1};
+	unsigned serviceCount{0};
+};
+
+/*
+ * Each device gets `width` services and, above the bottom level, `width` embedded devices
+ */
+void populate(Device& device, unsigned width, unsigned depth, TreeStats& stats)
+{
+	for(unsigned i = 0; i < width; ++i) {
+		device.addService(new BenchService(device, stats.serviceCount++));
+	}
+
+	if(depth <= 1) {
+		return;
+	}
+
+	for(unsigned i = 0; i < width; ++i) {
+		auto child = new BenchDevice(device, stats.deviceCount++);
+		device.addDevice(child);
+		populate(*child, width, depth - 1, stats);
+	}
+}
+
+/*
+ * Read description in chunks, as the HTTP server would
+ */
+size_t generate(Device& device, char* buffer, unsigned chunkSize, String* output = nullptr)
+{
+	DescriptionStream stream(device, device.getField(Device::Field::descriptionURL));
+	size_t total{0};
+	while(!stream.isFinished()) {
+		auto len = stream.readMemoryBlock(buffer, chunkSize);
+		if(len == 0) {
+			break;
+		}
+		if(output != nullptr) {
+			output->concat(buffer, len);
+		}
+		stream.seek(len);
+		total += len;
+	}
+	return total;
+}
+
+/*
+ * Feed description to parser in chunks, as the HTTP client would
+ */
+bool parse(ControlPoint& controlPoint, const String& location, const String& content, unsigned chunkSize,
+		   size_t blockSize)
+{
+	DescriptionParser parser(controlPoint, location, blockSize);
+	auto data = reinterpret_cast<const uint8_t*>(content.c_str());
+	for(size_t pos = 0; pos < content.length(); pos += chunkSize) {
+		parser.write(data + pos, std::min(size_t(chunkSize), content.length() - pos));
+	}
+	return parser.rootDevice != nullptr;
+}
+
+String chunkTitle(const String& name, unsigned chunkSize)
+{
+	String s = name;
+	s += F(" (chunk ");
+	s += chunkSize;
+	s += ')';
+	return s;
+}
+
+} // namespace
+} // namespace UPnP
+
+namespace Bench
+{
+using namespace UPnP;
+
+void description(Print& p, unsigned iterations, unsigned width, unsigned depth)
+{
+	schemas_upnp_org::registerClasses();
+	ControlPoint::registerClasses(domain_sming, benchClasses);
+
+	ControlPoint controlPoint;
+	std::unique_ptr<char[]> buffer(new char[chunkSizes[ARRAY_SIZE(chunkSizes) - 1]]);
+
+	TreeStats stats;
+	BenchDevice root(0);
+	populate(root, width, depth, stats);
+
+	String xml;
+	generate(root, buffer.get(), 1460, &xml);
+
+	p.println();
+	p.print(F("Description: synthetic tree width "));
+	p.print(width);
+	p.print(F(", depth "));
+	p.print(depth);
+	p.print(F(", "));
+	p.print(stats.deviceCount);
+	p.print(F(" devices, "));
+	p.print(stats.serviceCount);
+	p.print(F(" services, "));
+	p.print(xml.length());
+	p.println(F(" bytes"));
+
+	if(!parse(controlPoint, benchLocation, xml, xml.length(), 0)) {
+		p.println(F("** Generated description failed to parse"));
+		return;
+	}
+
+	printHeader(p);
+
+	auto report = [&](const String& name, Function function) { printResult(p, run(name, iterations, function)); };
+
+	// Fixed size, independent of options, so it can be checked against a fixed allocation limit
+	BenchDevice single(0);
+	single.addService(new BenchService(single, 0));
+	report(F("description GET"), [&]() { generate(single, buffer.get(), 1460); });
+
+	for(auto chunkSize : chunkSizes) {
+		report(chunkTitle(F("generate"), chunkSize), [&]() { generate(root, buffer.get(), chunkSize); });
+	}
+
+	for(auto chunkSize : chunkSizes) {
+		report(chunkTitle(F("parse"), chunkSize),
+			   [&]() { parse(controlPoint, benchLocation, xml, chunkSize, 0); });
+	}
+
+	report(chunkTitle(F("parse, arena"), 1460),
+		   [&]() { parse(controlPoint, benchLocation, xml, 1460, arenaBlockSize); });
+
+	for(unsigned i = 0; i < captures.length(); ++i) {
+		String capture = captures[i];
+		String path = F(SCAN_CONFIG_DIR "/");
+		path += capture;
+		HostFileStream fs;
+		if(!fs.open(path, File::ReadOnly)) {
+			p.print(F("** Cannot open "));
+			p.println(path);
+			continue;
+		}
+		String content = fs.readString(fs.available());
+		String location = F("http://192.168.1.10:8080/");
+		location += capture;
+
+		if(!parse(controlPoint, location, content, content.length(), 0)) {
+			p.print(F("** Failed to parse "));
+			p.println(capture);
+			continue;
+		}
+
+		for(auto chunkSize : chunkSizes) {
+			report(chunkTitle(capture, chunkSize), [&]() { parse(controlPoint, location, content, chunkSize, 0); });
+		}
+	}
+}
+
+} // namespace Bench
@@ -0,0 +1,431 @@
+#include "Bench.h"
+#include <Network/UPnP/Device.h>
+#include <Network/UPnP/Service.h>
+#include <Network/UPnP/ActionDispatch.h>
+
+// Parser is internal to the library
+#include "../../../src/EnvelopeParser.h"
+
+/*
+ * Requests are run through the same steps as `Service::handleUrlRequest()`:
+ * the envelope is loaded, the action dispatched and the response (or fault) serialized.
+ *
+ * Handlers use a dispatch table in the same way as generated service templates.
+ */
+
+namespace UPnP
+{
+namespace
+{
+using namespace ActionDispatch;
+
+DEFINE_FSTR_LOCAL(domain_upnp, "schemas-upnp-org")
+DEFINE_FSTR_LOCAL(type_MediaServer, "MediaServer")
+DEFINE_FSTR_LOCAL(type_ContentDirectory, "ContentDirectory")
+DEFINE_FSTR_LOCAL(type_RenderingControl, "RenderingControl")
+DEFINE_FSTR_LOCAL(type_AVTransport, "AVTransport")
+
+const ObjectClass mediaServerClass PROGMEM{Urn::Kind::device, 1, &domain_upnp, &type_MediaServer, nullptr, {}};
+const ObjectClass contentDirectoryClass PROGMEM{Urn::Kind::service, 1, &domain_upnp, &type_ContentDirectory, nullptr,
+												{}};
+const ObjectClass renderingControlClass PROGMEM{Urn::Kind::service, 1, &domain_upnp, &type_RenderingControl, nullptr,
+												{}};
+const ObjectClass avTransportClass PROGMEM{Urn::Kind::service, 1, &domain_upnp, &type_AVTransport, nullptr, {}};
+
+#define LOCALSTR(x) DEFINE_FSTR_LOCAL(fs_##x, #x)
+
+LOCALSTR(Browse)
+LOCALSTR(SetVolume)
+LOCALSTR(GetPositionInfo)
+LOCALSTR(ObjectID)
+LOCALSTR(BrowseFlag)
+LOCALSTR(Filter)
+LOCALSTR(StartingIndex)
+LOCALSTR(RequestedCount)
+LOCALSTR(SortCriteria)
+LOCALSTR(Result)
+LOCALSTR(NumberReturned)
+LOCALSTR(TotalMatches)
+LOCALSTR(UpdateID)
+LOCALSTR(InstanceID)
+LOCALSTR(Channel)
+LOCALSTR(DesiredVolume)
+LOCALSTR(Track)
+LOCALSTR(TrackDuration)
+LOCALSTR(TrackMetaData)
+LOCALSTR(TrackURI)
+LOCALSTR(RelTime)
+LOCALSTR(AbsTime)
+LOCALSTR(RelCount)
+LOCALSTR(AbsCount)
+LOCALSTR(SetAVTransportURI)
+LOCALSTR(CurrentURI)
+LOCALSTR(CurrentURIMetaData)
+
+DEFINE_FSTR_LOCAL(browseRequest, "<?xml version=\"1.0\"?>"
+								 "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+								 "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+								 "<s:Body>"
+								 "<u:Browse xmlns:u=\"urn:schemas-upnp-org:service:ContentDirectory:1\">"
+								 "<ObjectID>64$1$2</ObjectID>"
+								 "<BrowseFlag>BrowseDirectChildren</BrowseFlag>"
+								 "<Filter>*</Filter>"
+								 "<StartingIndex>0</StartingIndex>"
+								 "<RequestedCount>0</RequestedCount>"
+								 "<SortCriteria>+dc:title</SortCriteria>"
+								 "</u:Browse>"
+								 "</s:Body>"
+								 "</s:Envelope>")
+
+DEFINE_FSTR_LOCAL(setVolumeRequest, "<?xml version=\"1.0\"?>"
+									"<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+									"s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+									"<s:Body>"
+									"<u:SetVolume xmlns:u=\"urn:schemas-upnp-org:service:RenderingControl:1\">"
+									"<InstanceID>0</InstanceID>"
+									"<Channel>Master</Channel>"
+									"<DesiredVolume>42</DesiredVolume>"
+									"</u:SetVolume>"
+									"</s:Body>"
+									"</s:Envelope>")
+
+DEFINE_FSTR_LOCAL(getPositionInfoRequest, "<?xml version=\"1.0\"?>"
+										  "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+										  "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+										  "<s:Body>"
+										  "<u:GetPositionInfo xmlns:u=\"urn:schemas-upnp-org:service:AVTransport:1\">"
+										  "<InstanceID>0</InstanceID>"
+										  "</u:GetPositionInfo>"
+										  "</s:Body>"
+										  "</s:Envelope>")
+
+DEFINE_FSTR_LOCAL(unknownActionRequest, "<?xml version=\"1.0\"?>"
+										"<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+										"s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+										"<s:Body>"
+										"<u:Seek xmlns:u=\"urn:schemas-upnp-org:service:AVTransport:1\">"
+										"<InstanceID>0</InstanceID>"
+										"<Unit>REL_TIME</Unit>"
+										"<Target>0:01:00</Target>"
+										"</u:Seek>"
+										"</s:Body>"
+										"</s:Envelope>")
+
+DEFINE_FSTR_LOCAL(faultResponse, "<?xml version=\"1.0\"?>"
+								 "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+								 "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+								 "<s:Body>"
+								 "<s:Fault>"
+								 "<faultcode>s:Client</faultcode>"
+								 "<faultstring>UPnPError</faultstring>"
+								 "<detail>"
+								 "<UPnPError xmlns=\"urn:schemas-upnp-org:control-1-0\">"
+								 "<errorCode>701</errorCode>"
+								 "<errorDescription>No such object</errorDescription>"
+								 "</UPnPError>"
+								 "</detail>"
+								 "</s:Fault>"
+								 "</s:Body>"
+								 "</s:Envelope>")
+
+DEFINE_FSTR_LOCAL(trackMetaData, "<DIDL-Lite xmlns=\"urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/\" "
+								 "xmlns:dc=\"http://purl.org/dc/elements/1.1/\" "
+								 "xmlns:upnp=\"urn:schemas-upnp-org:metadata-1-0/upnp/\">"
+								 "<item id=\"64$1$2$7\" parentID=\"64$1$2\" restricted=\"1\">"
+								 "<dc:title>Track 7</dc:title>"
+								 "<upnp:class>object.item.audioItem.musicTrack</upnp:class>"
+								 "<upnp:artist>Artist</upnp:artist>"
+								 "<upnp:album>Album</upnp:album>"
+								 "<res duration=\"0:04:12.000\">http://192.168.1.10:8200/MediaItems/7.flac</res>"
+								 "</item>"
+								 "</DIDL-Lite>")
+
+/*
+ * Build a Browse result containing the given number of music tracks
+ */
+String createDidl(unsigned itemCount)
+{
+	String s;
+	s += F("<DIDL-Lite xmlns=\"urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/\" "
+		   "xmlns:dc=\"http://purl.org/dc/elements/1.1/\" "
+		   "xmlns:upnp=\"urn:schemas-upnp-org:metadata-1-0/upnp/\">");
+	for(unsigned i = 0; i < itemCount; ++i) {
+		s += F("<item id=\"64$1$2$");
+		s += i;
+		s += F("\" parentID=\"64$1$2\" restricted=\"1\"><dc:title>Track ");
+		s += i;
+		s += F(" &amp; friends</dc:title><upnp:class>object.item.audioItem.musicTrack</upnp:class>"
+			   "<upnp:artist>Artist</upnp:artist><upnp:album>Album</upnp:album>"
+			   "<upnp:albumArtURI>http://192.168.1.10:8200/AlbumArt/");
+		s += i;
+		s += F(".jpg</upnp:albumArtURI><res size=\"31457280\" duration=\"0:04:12.000\" "
+			   "protocolInfo=\"http-get:*:audio/x-flac:*\">http://192.168.1.10:8200/MediaItems/");
+		s += i;
+		s += F(".flac</res></item>");
+	}
+	s += F("</DIDL-Lite>");
+	return s;
+}
+
+class MediaServer : public Device
+{
+public:
+	const ObjectClass& getClass() const override
+	{
+		return mediaServerClass;
+	}
+};
+
+/*
+ * Handles actions for all three service types
+ */
+class MediaService : public Service
+{
+public:
+	MediaService(Device& device, const ObjectClass& objectClass, const String& didl)
+		: Service(device), objectClass(objectClass), didl(didl)
+	{
+	}
+
+	const ObjectClass& getClass() const override
+	{
+		return objectClass;
+	}
+
+	Error handleAction(ActionRequest& req) override;
+
+	Error browse(ActionRequest& req)
+	{
+		auto objectId = req.getArg<String>(fs_ObjectID);
+		auto browseFlag = req.getArg<String>(fs_BrowseFlag);
+		auto startingIndex = req.getArg<uint32_t>(fs_StartingIndex);
+		auto requestedCount = req.getArg<uint32_t>(fs_RequestedCount);
+		(void)objectId;
+		(void)browseFlag;
+		(void)startingIndex;
+		(void)requestedCount;
+
+		ActionResponse response(req);
+		response.setArg(fs_Result, didl);
+		response.setArg(fs_NumberReturned, itemCount);
+		response.setArg(fs_TotalMatches, itemCount);
+		response.setArg(fs_UpdateID, 12);
+		return Error::Success;
+	}
+
+	Error setVolume(ActionRequest& req)
+	{
+		volume = req.getArg<uint16_t>(fs_DesiredVolume);
+		ActionResponse response(req);
+		(void)response;
+		return Error::Success;
+	}
+
+	Error getPositionInfo(ActionRequest& req)
+	{
+		ActionResponse response(req);
+		response.setArg(fs_Track, 7);
+		response.setArg(fs_TrackDuration, F("0:04:12"));
+		response.setArg(fs_TrackMetaData, String(trackMetaData));
+		response.setArg(fs_TrackURI, F("http://192.168.1.10:8200/MediaItems/7.flac"));
+		response.setArg(fs_RelTime, F("0:01:23"));
+		response.setArg(fs_AbsTime, F("0:01:23"));
+		response.setArg(fs_RelCount, 2147483647);
+		response.setArg(fs_AbsCount, 2147483647);
+		return Error::Success;
+	}
+
+	unsigned itemCount{0};
+
+private:
+	const ObjectClass& objectClass;
+	const String& didl;
+	uint16_t volume{0};
+};
+
+using Handler = Error (MediaService::*)(ActionRequest& req);
+
+const ArgInfo browseArgs[]{
+	{&fs_ObjectID, ArgType::string},	   {&fs_BrowseFlag, ArgType::string},   {&fs_Filter, ArgType::string},
+	{&fs_StartingIndex, ArgType::ui4},	 {&fs_RequestedCount, ArgType::ui4}, {&fs_SortCriteria, ArgType::string},
+};
+
+const ArgInfo setVolumeArgs[]{
+	{&fs_InstanceID, ArgType::ui4},
+	{&fs_Channel, ArgType::string},
+	{&fs_DesiredVolume, ArgType::ui2},
+};
+
+const ArgInfo getPositionInfoArgs[]{
+	{&fs_InstanceID, ArgType::ui4},
+};
+
+constexpr Table<Handler, 3> actions{{
+	UPNP_ACTION_INFO(Browse, &MediaService::browse, browseArgs),
+	UPNP_ACTION_INFO(SetVolume, &MediaService::setVolume, setVolumeArgs),
+	UPNP_ACTION_INFO(GetPositionInfo, &MediaService::getPositionInfo, getPositionInfoArgs),
+}};
+
+Error MediaService::handleAction(ActionRequest& req)
+{
+	return actions.dispatch(*this, req);
+}
+
+/*
+ * Equivalent to `Service::handleUrlRequest()` and `ActionResponse::Stream::complete()`
+ */
+size_t processRequest(Service& service, const FlashString& request)
+{
+	Envelope env(service);
+	auto err = env.load(request);
+	if(!err) {
+		ActionRequest req(env, nullptr);
+		err = service.handleAction(req);
+	}
+
+	if(!!err) {
+		env.createFault(getErrorCode(err));
+	} else if(env.contentType() != Envelope::ContentType::response) {
+		env.createFault(ErrorCode::OptionalActionNotImplemented);
+	}
+
+	Bench::NullPrint out;
+	env.serialize(out, false);
+	return out.count;
+}
+
+/*
+ * Equivalent to the HTTP server body parser, with content arriving in chunks
+ */
+Error streamRequest(Service& service, const String& request, size_t chunkSize)
+{
+	EnvelopeParser parser(service, request.length());
+	for(size_t pos = 0; pos < request.length(); pos += chunkSize) {
+		parser.write(request.c_str() + pos, std::min(chunkSize, request.length() - pos));
+	}
+	return parser.finish();
+}
+
+} // namespace
+} // namespace UPnP
+
+namespace Bench
+{
+using namespace UPnP;
+
+void envelope(Print& p, unsigned iterations, unsigned itemCount)
+{
+	String didl = createDidl(itemCount);
+
+	MediaServer device;
+	MediaService contentDirectory(device, contentDirectoryClass, didl);
+	MediaService renderingControl(device, renderingControlClass, didl);
+	MediaService avTransport(device, avTransportClass, didl);
+	contentDirectory.itemCount = itemCount;
+
+	String browseTitle = F("Browse (");
+	browseTitle += itemCount;
+	browseTitle += F(" items)");
+
+	// Capture Browse response for client-side parsing
+	String browseResponse;
+	{
+		Envelope env(contentDirectory);
+		env.load(browseRequest);
+		ActionRequest req(env, nullptr);
+		contentDirectory.handleAction(req);
+		browseResponse = env.serialize(false);
+	}
+
+	// SetAVTransportURI carrying the Browse result as metadata, escaped by serialization
+	String setUriRequest;
+	{
+		Envelope env(avTransport);
+		env.createRequest(fs_SetAVTransportURI);
+		env.addArg(fs_InstanceID, 0);
+		env.addArg(fs_CurrentURI, F("http://192.168.1.10:8200/MediaItems/7.flac"));
+		env.addArg(fs_CurrentURIMetaData, didl);
+		setUriRequest = env.serialize(false);
+	}
+	String setUriTitle = F("SetAVTransportURI (");
+	setUriTitle += setUriRequest.length();
+	setUriTitle += F(" bytes)");
+
+	String browseRequestString = browseRequest;
+
+	p.println();
+	p.println(F("SOAP envelope"));
+	printHeader(p);
+
+	auto report = [&](const String& name, Function function) { printResult(p, run(name, iterations, function)); };
+
+	report(browseTitle + F(": load"), [&]() {
+		Envelope env(contentDirectory);
+		env.load(browseRequest);
+	});
+
+	report(browseTitle + F(": stream (chunk 1460)"),
+		   [&]() { streamRequest(contentDirectory, browseRequestString, 1460); });
+
+	report(browseTitle + F(": load + getArg"), [&]() {
+		Envelope env(contentDirectory);
+		env.load(browseRequest);
+		String objectId;
+		uint32_t count;
+		env.getArg(fs_ObjectID, objectId);
+		env.getArg(fs_RequestedCount, count);
+	});
+
+	report(browseTitle + F(": pipeline"), [&]() { processRequest(contentDirectory, browseRequest); });
+
+	report(browseTitle + F(": serialize"), [&]() {
+		Envelope env(contentDirectory);
+		env.createResponse(fs_Browse);
+		env.addArg(fs_Result, didl);
+		env.addArg(fs_NumberReturned, itemCount);
+		env.addArg(fs_TotalMatches, itemCount);
+		env.addArg(fs_UpdateID, 12);
+		NullPrint out;
+		env.serialize(out, false);
+	});
+
+	report(browseTitle + F(": client parse"), [&]() {
+		Envelope env(contentDirectory);
+		env.load(String(browseResponse));
+		String result;
+		env.getArg(fs_Result, result);
+	});
+
+	if(!!streamRequest(avTransport, setUriRequest, 1460)) {
+		p.println(F("** SetAVTransportURI request failed to parse"));
+	}
+
+	report(setUriTitle + F(": load"), [&]() {
+		Envelope env(avTransport);
+		env.load(String(setUriRequest));
+	});
+
+	for(auto chunkSize : {64U, 1460U}) {
+		String title = setUriTitle;
+		title += F(": stream (chunk ");
+		title += chunkSize;
+		title += ')';
+		report(title, [&]() { streamRequest(avTransport, setUriRequest, chunkSize); });
+	}
+
+	report(F("SetVolume: pipeline"), [&]() { processRequest(renderingControl, setVolumeRequest); });
+
+	report(F("GetPositionInfo: pipeline"), [&]() { processRequest(avTransport, getPositionInfoRequest); });
+
+	report(F("Fault: generate"), [&]() { processRequest(avTransport, unknownActionRequest); });
+
+	report(F("Fault: client parse"), [&]() {
+		Envelope env(contentDirectory);
+		env.load(faultResponse);
+		auto fault = env.fault();
+		fault.errorCode();
+		fault.errorDescription();
+	});
+}
+
+} // namespace Bench
@@ -0,0 +1,118 @@
+#include "Bench.h"
+#include <Network/UPnP/Device.h>
+#include <Network/UPnP/DeviceHost.h>
+
+/*
+ * Each SSDP search response or notification is built by the matching device object,
+ * as `SearchCursor::sendMessage()` does when the message is due.
+ * The same messages are formatted with and without the device field cache.
+ */
+
+namespace UPnP
+{
+namespace
+{
+DEFINE_FSTR_LOCAL(domain_sming, "schemas-sming-org")
+DEFINE_FSTR_LOCAL(type_SsdpDevice, "SsdpBenchDevice")
+
+const ObjectClass ssdpDeviceClass PROGMEM{
+	Urn::Kind::device, 1, &domain_sming, &type_SsdpDevice, nullptr, {},
+};
+
+class SsdpDevice : public Device
+{
+public:
+	const ObjectClass& getClass() const override
+	{
+		return ssdpDeviceClass;
+	}
+
+	String getField(Field desc) const override
+	{
+		switch(desc) {
+		case Field::friendlyName:
+			return F("SSDP bench device");
+		case Field::manufacturer:
+			return F("Sming");
+		case Field::modelName:
+			return F("Benchmark");
+		case Field::UDN:
+			return F("uuid:5d794fc2-5c5e-4460-a023-ssdp");
+		default:
+			return Device::getField(desc);
+		}
+	}
+};
+
+void formatMessage(Device& device, MessageSpec& ms)
+{
+	Message msg;
+	msg.type = ms.type();
+	if(ms.type() != MessageType::notify || ms.notifySubtype() == NotifySubtype::alive) {
+		String maxAge = F("max-age=");
+		maxAge += deviceHost.maxAge();
+		msg[HTTP_HEADER_CACHE_CONTROL] = maxAge;
+	}
+	device.formatMessage(msg, ms);
+}
+
+} // namespace
+} // namespace UPnP
+
+namespace Bench
+{
+using namespace UPnP;
+
+void ssdp(Print& p, unsigned iterations)
+{
+	SsdpDevice device;
+
+	MessageSpec response(MessageType::response);
+	MessageSpec alive(NotifySubtype::alive, SearchTarget::all);
+
+	struct Match {
+		SearchMatch match;
+		const char* name;
+	};
+	const Match matches[]{
+		{SearchMatch::root, "root"},
+		{SearchMatch::uuid, "uuid"},
+		{SearchMatch::type, "type"},
+	};
+
+	p.println();
+	p.println(F("SSDP"));
+	printHeader(p);
+
+	auto report = [&](const String& name, Function function) { printResult(p, run(name, iterations, function)); };
+
+	auto runAll = [&](const String& suffix) {
+		for(auto& m : matches) {
+			String name = F("response, ");
+			name += m.name;
+			name += suffix;
+			report(name, [&]() {
+				response.setMatch(m.match);
+				formatMessage(device, response);
+			});
+
+			name = F("notify alive, ");
+			name += m.name;
+			name += suffix;
+			report(name, [&]() {
+				alive.setMatch(m.match);
+				formatMessage(device, alive);
+			});
+		}
+
+		report(String(F("getLocation")) + suffix, [&]() { device.getLocation(); });
+	};
+
+	runAll("");
+
+	device.enableFieldCache(true);
+	runAll(F(" (cached)"));
+	device.enableFieldCache(false);
+}
+
+} // namespace Bench
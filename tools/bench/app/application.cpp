@@ -0,0 +1,149 @@
+#include <SmingCore.h>
+#include "Bench.h"
+
+namespace
+{
+unsigned iterations{1000};
+unsigned itemCount{100};
+unsigned treeWidth{3};
+unsigned treeDepth{2};
+unsigned tolerance{0};
+bool recordBudget{false};
+bool checkBudget{false};
+String budgetFile{BENCH_DIR "/alloc-budget.csv"};
+
+void help()
+{
+	Serial.println();
+	Serial.println(F("UPnP benchmarks. Usage:"));
+	Serial.println(F("  bench [options] [suite...]"));
+	Serial.println();
+	Serial.println(F("Suites (default is all):"));
+	Serial.println(F("  envelope                  SOAP envelope parsing, dispatch and serialization"));
+	Serial.println(F("  description               Description generation and parsing"));
+	Serial.println(F("  ssdp                      SSDP search response and notification formatting"));
+	Serial.println();
+	Serial.println(F("Options:"));
+	Serial.println(F("  --iterations=N            Number of times to run each benchmark (default 1000)"));
+	Serial.println(F("  --items=N                 Number of items in Browse results (default 100)"));
+	Serial.println(F("  --width=N                 Services and embedded devices per device (default 3)"));
+	Serial.println(F("  --depth=N                 Levels of devices in generated description (default 2)"));
+	Serial.println(F("  --record-budget           Write allocation figures to the budget file"));
+	Serial.println(F("  --check-budget            Fail if allocation figures exceed the budget file"));
+	Serial.println(F("  --tolerance=N             Percentage by which figures may exceed budget (default 0)"));
+	Serial.println(F("  --budget=FILE             Budget file (default alloc-budget.csv in the tool directory)"));
+	Serial.println();
+}
+
+bool parseOption(const String& param)
+{
+	auto getValue = [&](const char* name, unsigned& value) -> bool {
+		auto len = strlen(name);
+		if(!param.startsWith(name) || param[len] != '=') {
+			return false;
+		}
+		value = std::max(atoi(param.c_str() + len + 1), 1);
+		return true;
+	};
+
+	if(param == F("--record-budget")) {
+		recordBudget = true;
+		return true;
+	}
+	if(param == F("--check-budget")) {
+		checkBudget = true;
+		return true;
+	}
+	if(param.startsWith(F("--tolerance="))) {
+		tolerance = std::max(atoi(param.c_str() + 12), 0);
+		return true;
+	}
+	if(param.startsWith(F("--budget="))) {
+		budgetFile = param.substring(9);
+		return true;
+	}
+
+	return getValue("--iterations", iterations) || getValue("--items", itemCount) || getValue("--width", treeWidth) ||
+		   getValue("--depth", treeDepth);
+}
+
+bool runAll()
+{
+	auto parameters = commandLine.getParameters();
+	Vector<String> suites;
+	for(unsigned i = 0; i < parameters.count(); ++i) {
+		String param = parameters[i].text;
+		if(param.startsWith("--")) {
+			if(!parseOption(param)) {
+				Serial.print(_F("** Unknown option "));
+				Serial.println(param);
+				return false;
+			}
+		} else {
+			suites.add(param);
+		}
+	}
+
+	auto enabled = [&](const String& name) { return suites.isEmpty() || suites.contains(name); };
+
+	bool found{false};
+	if(enabled(F("envelope"))) {
+		Bench::envelope(Serial, iterations, itemCount);
+		found = true;
+	}
+
+	if(enabled(F("description"))) {
+		Bench::description(Serial, iterations, treeWidth, treeDepth);
+		found = true;
+	}
+
+	if(enabled(F("ssdp"))) {
+		Bench::ssdp(Serial, iterations);
+		found = true;
+	}
+
+	if(!found) {
+		Serial.println(F("** No matching benchmark suites"));
+		return false;
+	}
+
+	Serial.println();
+	return true;
+}
+
+/*
+ * Returns exit code, non-zero if any benchmark exceeds its allocation budget
+ */
+int checkResults()
+{
+	if(recordBudget && !Bench::saveBudget(Serial, budgetFile)) {
+		return 1;
+	}
+
+	if(checkBudget && Bench::checkBudget(Serial, budgetFile, tolerance) != 0) {
+		return 1;
+	}
+
+	return 0;
+}
+
+} // namespace
+
+void init()
+{
+	Serial.setTxBufferSize(1024);
+	Serial.begin(SERIAL_BAUD_RATE);
+	Serial.systemDebugOutput(false);
+
+	System.onReady([]() {
+		if(!runAll()) {
+			help();
+			exit(1);
+		}
+		auto exitCode = checkResults();
+		if(exitCode != 0) {
+			exit(exitCode);
+		}
+		System.restart();
+	});
+}
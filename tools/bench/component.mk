@@ -0,0 +1,12 @@
+ARDUINO_LIBRARIES := UPnP
+APP_NAME := bench
+
+# Heap allocations are counted using the malloc wrapper
+COMPONENT_DEPENDS := malloc_count UPnP-Schema
+ENABLE_MALLOC_COUNT := 1
+
+# Captured descriptions used for parser benchmarks
+APP_CFLAGS += -DSCAN_CONFIG_DIR=\"$(PROJECT_DIR)/../scan/config\"
+
+# Default location of allocation budget file
+APP_CFLAGS += -DBENCH_DIR=\"$(PROJECT_DIR)\"
@@ -3,11 +3,21 @@
 #define FETCH_STATE_MAP(XX)                                                                                            \
 	XX(none)                                                                                                           \
 	XX(pending)                                                                                                        \
+	XX(active)                                                                                                         \
 	XX(success)                                                                                                        \
 	XX(failed)                                                                                                         \
 	XX(skipped)
 
-// Fetch one description file at a time to avoid swamping the TCP stack
+// Make path suitable for use as a filename
+inline String& validate(String& path)
+{
+	path.replace(':', '-');
+	path.replace('?', '-');
+	path.replace('&', '-');
+	path.replace(' ', '_');
+	return path;
+}
+
 struct Fetch {
 	enum class State {
 #define XX(n) n,
@@ -25,6 +35,8 @@ struct Fetch {
 	String id;
 	State state{State::none};
 	uint8_t attempts{0};
+	uint32_t startTime{0};
+	unsigned sequence{0}; ///< Identifies fetch while a request is in flight, as list storage may move
 
 	Fetch() = default;
 	Fetch(const Fetch&) = default;
@@ -126,6 +138,7 @@ public:
 		if(i < 0) {
 			f.state = Fetch::State::pending;
 			f.attempts = 0;
+			f.sequence = ++lastSequence;
 
 			if(f.kind == Urn::Kind::service) {
 				insertElementAt(f, 0);
@@ -156,6 +169,21 @@ public:
 		return nil;
 	}
 
+	/**
+	 * @brief Locate a fetch by sequence number
+	 * @retval Fetch* nullptr if not found
+	 */
+	Fetch* findSequence(unsigned sequence)
+	{
+		for(unsigned i = 0; i < count(); ++i) {
+			auto& f = operator[](i);
+			if(f.sequence == sequence) {
+				return &f;
+			}
+		}
+		return nullptr;
+	}
+
 	using Vector::count;
 
 	unsigned count(Fetch::States states) const
@@ -189,6 +217,7 @@ public:
 
 private:
 	String name;
+	unsigned lastSequence{0};
 };
 
 inline String toString(Fetch::State state)
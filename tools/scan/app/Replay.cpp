@@ -0,0 +1,262 @@
+#include <SmingCore.h>
+#include "Replay.h"
+
+#ifdef ARCH_HOST
+
+#include <Data/Stream/HostFileStream.h>
+#include <Data/BitSet.h>
+#include "Fetch.h"
+#include <Network/SSDP/Server.h>
+#include <dirent.h>
+#if ENABLE_MALLOC_COUNT
+#include <malloc_count.h>
+#endif
+
+unsigned Replay::addCapture(String root, const Urn& urn)
+{
+	this->urn = urn;
+	root.replace('\\', '/');
+	if(root.endsWith("/")) {
+		root.setLength(root.length() - 1);
+	}
+
+	auto d = opendir(root.c_str());
+	if(d == nullptr) {
+		m_printf("Cannot open '%s'\r\n", root.c_str());
+		return 0;
+	}
+
+	String st = urn.toString();
+	unsigned count{0};
+	unsigned duplicates{0};
+	while(auto entry = readdir(d)) {
+		String name = entry->d_name;
+		if(!name.startsWith("ssdp-") || !name.endsWith(".txt")) {
+			continue;
+		}
+
+		HostFileStream fs(root + '/' + name);
+		String content = fs.readString(fs.available());
+
+		Message msg{root};
+		bool match{false};
+		int pos = 0;
+		while(pos < int(content.length())) {
+			int eol = content.indexOf('\n', pos);
+			if(eol < 0) {
+				eol = content.length();
+			}
+			String line = content.substring(pos, eol);
+			pos = eol + 1;
+			line.trim();
+			int sep = line.indexOf(':');
+			if(sep <= 0 || line.startsWith("Message type")) {
+				continue;
+			}
+			String field = line.substring(0, sep);
+			String value = line.substring(sep + 1);
+			value.trim();
+			if(field.equalsIgnoreCase("LOCATION")) {
+				msg.path = Url(value).getRelativePath();
+				continue;
+			}
+			if(field.equalsIgnoreCase("ST") && value == st) {
+				match = true;
+			}
+			if(field.equalsIgnoreCase("USN")) {
+				msg.usn = value;
+			}
+			msg.headers += line;
+			msg.headers += "\r\n";
+		}
+
+		if(!match || !msg.path) {
+			continue;
+		}
+		if(contains(msg.usn)) {
+			++duplicates;
+			continue;
+		}
+		messages.add(msg);
+		++count;
+	}
+
+	closedir(d);
+
+	if(duplicates != 0) {
+		m_printf("Skipped %u messages with duplicate USN in '%s'\r\n", duplicates, root.c_str());
+	}
+	return count;
+}
+
+bool Replay::contains(const String& usn) const
+{
+	for(unsigned i = 0; i < messages.count(); ++i) {
+		if(messages[i].usn == usn) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Replay::begin(uint16_t port, unsigned rate, unsigned passes)
+{
+	if(messages.count() == 0) {
+		m_puts("No messages to replay\r\n");
+		return false;
+	}
+
+	if(!server.listen(port)) {
+		m_printf("Failed to listen on port %u\r\n", port);
+		return false;
+	}
+	server.paths.setDefault(HttpPathDelegate(&Replay::onHttpRequest, this));
+
+	baseUrl = F("http://");
+	baseUrl += WifiStation.getIP().toString();
+	baseUrl += ':';
+	baseUrl += port;
+
+	this->rate = std::max(rate, 1U);
+	interval = std::max(1000U / this->rate, 1U);
+	this->passes = std::max(passes, 1U);
+
+	m_printf("Replaying %u messages at %u/s, %u passes\r\n", messages.count(), this->rate, this->passes);
+
+#if ENABLE_MALLOC_COUNT
+	MallocCount::resetPeak();
+#endif
+	stats.begin();
+	pass = 0;
+	beginPass();
+	return true;
+}
+
+void Replay::beginPass()
+{
+	// Forget devices found in the previous pass
+	controlPoint.reset();
+	controlPoint.beginSearch(urn, UPnP::DescriptionSearch::Callback(&Replay::onDescription, this));
+	++stats.searchCount;
+	next = 0;
+	passStartTime = millis();
+	injectTimer.initializeMs(interval, TimerDelegate(&Replay::inject, this)).start();
+}
+
+/*
+ * Inject however many messages are due by now, so any rate is achieved on average
+ * regardless of timer resolution
+ */
+void Replay::inject()
+{
+	auto due = 1 + uint64_t(millis() - passStartTime) * rate / 1000;
+	while(next < due && next < messages.count()) {
+		injectMessage(messages[next++]);
+	}
+
+	if(next < messages.count()) {
+		return;
+	}
+
+	injectTimer.stop();
+	checkComplete();
+}
+
+void Replay::injectMessage(Message& msg)
+{
+	String data = F("HTTP/1.1 200 OK\r\n");
+	data += msg.headers;
+	data += F("LOCATION: ");
+	data += baseUrl;
+	data += '/';
+	data += next - 1;
+	data += msg.path;
+	data += "\r\n\r\n";
+
+	SSDP::BasicMessage ssdp;
+	if(ssdp.parse(data.begin(), data.length()) != HPE_OK) {
+		m_printf("Bad message: %s\r\n", data.c_str());
+		return;
+	}
+	ssdp.remoteIP = WifiStation.getIP();
+	ssdp.remotePort = SSDP::multicastPort;
+
+	msg.injectTime = millis();
+	++injected;
+	UPnP::ControlPoint::onSsdpMessage(ssdp);
+	idleTimer.initializeMs<idleTimeout>(TimerDelegate(&Replay::complete, this)).startOnce();
+}
+
+/*
+ * Description paths are prefixed with the message index
+ */
+void Replay::onHttpRequest(HttpRequest& request, HttpResponse& response)
+{
+	String path = request.uri.Path;
+	int sep = path.indexOf('/', 1);
+	unsigned index = path.substring(1, sep).toInt();
+	if(sep < 0 || index >= messages.count()) {
+		response.code = HTTP_STATUS_NOT_FOUND;
+		return;
+	}
+
+	Fetch f(Urn::Kind::device, nullptr, messages[index].root, path.substring(sep));
+	auto filename = f.fullPath();
+	validate(filename);
+	auto fs = new HostFileStream;
+	if(!fs->open(filename, File::ReadOnly)) {
+		delete fs;
+		response.code = HTTP_STATUS_NOT_FOUND;
+		return;
+	}
+
+	// The control point consumes the body before our callback runs, so note its size here
+	messages[index].bodySize = fs->available();
+	response.sendDataStream(fs, MIME_XML);
+}
+
+void Replay::onDescription(HttpConnection& connection, XML::Document* description)
+{
+	++received;
+
+	String path = connection.getRequest()->uri.Path;
+	unsigned index = path.substring(1, path.indexOf('/', 1)).toInt();
+	if(description == nullptr || index >= messages.count()) {
+		++stats.failCount;
+	} else {
+		stats.addFetch(millis() - messages[index].injectTime, messages[index].bodySize);
+	}
+
+	checkComplete();
+}
+
+void Replay::checkComplete()
+{
+	if(injectTimer.isStarted() || received < injected) {
+		return;
+	}
+
+	if(++pass < passes) {
+		beginPass();
+		return;
+	}
+
+	complete();
+}
+
+void Replay::complete()
+{
+	idleTimer.stop();
+	injectTimer.stop();
+	controlPoint.cancelSearch();
+
+	m_puts("REPLAY DONE\r\n");
+	m_printf("Injected %u messages, received %u descriptions\r\n", injected, received);
+	m_printf("%s\r\n", stats.toString().c_str());
+#if ENABLE_MALLOC_COUNT
+	m_printf("Heap: current %u, peak %u bytes\r\n", MallocCount::getCurrent(), MallocCount::getPeak());
+#endif
+	System.restart(1000);
+}
+
+#endif // ARCH_HOST
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Network/UPnP/ControlPoint.h>
+#include <Network/HttpServer.h>
+#include "Stats.h"
+
+/*
+ * Replays captured SSDP responses and serves the corresponding descriptions locally,
+ * so discovery performance can be measured without the original devices.
+ *
+ * Each capture root is a directory written by a network scan, i.e. `devices/{host}/{port}`.
+ * The LOCATION header of each message is re-written to point at our own HTTP server, prefixed with
+ * the message index so we can tell which capture it belongs to and measure latency.
+ */
+class Replay
+{
+public:
+	Replay(UPnP::ControlPoint& controlPoint) : controlPoint(controlPoint)
+	{
+	}
+
+	/**
+	 * @brief Load all matching SSDP messages from a capture directory
+	 * @retval unsigned Number of messages loaded
+	 * @note Messages with the same USN as one already loaded are skipped, as the control point
+	 * would only fetch the description once.
+	 */
+	unsigned addCapture(String root, const Urn& urn);
+
+	/**
+	 * @brief Start replay
+	 * @param port Local HTTP server port
+	 * @param rate Messages per second
+	 * @param passes Number of times to replay the capture
+	 */
+	bool begin(uint16_t port, unsigned rate, unsigned passes);
+
+private:
+	static constexpr unsigned idleTimeout{10000};
+
+	struct Message {
+		String root;    ///< Capture root directory
+		String headers; ///< All headers except LOCATION
+		String path;    ///< Original location path
+		String usn;
+		uint32_t injectTime;
+		uint32_t bodySize; ///< Bytes served for the most recent description request
+	};
+
+	void beginPass();
+	bool contains(const String& usn) const;
+	void inject();
+	void injectMessage(Message& msg);
+	void onDescription(HttpConnection& connection, XML::Document* description);
+	void onHttpRequest(HttpRequest& request, HttpResponse& response);
+	void checkComplete();
+	void complete();
+
+	UPnP::ControlPoint& controlPoint;
+	Vector<Message> messages;
+	HttpServer server;
+	Timer injectTimer;
+	Timer idleTimer;
+	Urn urn;
+	String baseUrl;
+	unsigned interval{0};
+	unsigned rate{0};
+	uint32_t passStartTime{0};
+	unsigned passes{0};
+	unsigned pass{0};
+	unsigned next{0};
+	unsigned injected{0};
+	unsigned received{0};
+	CrawlStats stats;
+};
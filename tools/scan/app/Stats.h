@@ -0,0 +1,59 @@
+#pragma once
+
+// Throughput and latency figures for a crawl
+struct CrawlStats {
+	uint32_t startTime{0};
+	unsigned fetchCount{0};
+	unsigned failCount{0};
+	unsigned searchCount{0};
+	size_t byteCount{0};
+	uint32_t totalLatency{0};
+	uint32_t minLatency{UINT32_MAX};
+	uint32_t maxLatency{0};
+
+	void begin()
+	{
+		*this = CrawlStats{};
+		startTime = millis();
+	}
+
+	void addFetch(uint32_t latency, size_t size)
+	{
+		++fetchCount;
+		byteCount += size;
+		totalLatency += latency;
+		minLatency = std::min(minLatency, latency);
+		maxLatency = std::max(maxLatency, latency);
+	}
+
+	String toString() const
+	{
+		auto elapsed = millis() - startTime;
+		auto secs = std::max(elapsed, uint32_t(1)) / 1000.0;
+
+		String s;
+		s += F("Elapsed ");
+		s += elapsed;
+		s += F("ms, ");
+		s += searchCount;
+		s += F(" searches, ");
+		s += fetchCount;
+		s += F(" fetches (");
+		s += failCount;
+		s += F(" failed), ");
+		s += String(fetchCount / secs, 2);
+		s += F(" fetches/s, ");
+		s += String(byteCount / 1024.0 / secs, 2);
+		s += F(" KB/s");
+		if(fetchCount != 0) {
+			s += F(", latency min/avg/max ");
+			s += minLatency;
+			s += '/';
+			s += totalLatency / fetchCount;
+			s += '/';
+			s += maxLatency;
+			s += F("ms");
+		}
+		return s;
+	}
+};
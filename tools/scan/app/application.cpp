@@ -3,6 +3,8 @@
 #include <Data/BitSet.h>
 #include <Data/CString.h>
 #include "Fetch.h"
+#include "Stats.h"
+#include "Replay.h"
 
 #ifdef ARCH_HOST
 #ifdef __WIN32__
@@ -11,7 +13,16 @@
 
 #include <hostlib/CommandLine.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <Data/Stream/HostFileStream.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
 #endif
 
 // If you want, you can define WiFi settings globally in Eclipse Environment Variables
@@ -29,12 +40,9 @@ UPnP::ControlPoint controlPoint(
 	8192
 #endif
 );
-Timer queueTimer;
 Timer statusTimer;
-Timer fetchTimer;
 
-void beginNextSearch();
-void fetchNextDescription();
+void pump();
 
 enum class Option {
 	networkScan,
@@ -47,13 +55,37 @@ enum class Option {
 BitSet<uint32_t, Option> options;
 
 constexpr unsigned maxDescriptionFetchAttempts{3};
-constexpr unsigned descriptionFetchTimeout{2000};
 constexpr unsigned fetchRetryDelay{1000};
-constexpr unsigned fetchInterval{500};
+constexpr unsigned searchDuration{5000};
+constexpr unsigned maxJobs{32};
 
 FetchList descriptionQueue("Descriptions");
 FetchList ssdpQueue("SSDP messages");
 
+/*
+ * Descriptions are fetched and searches performed concurrently, up to the given limits.
+ * Each search requires its own control point and runs for a fixed period.
+ */
+struct SearchJob {
+	UPnP::ControlPoint controlPoint;
+	Timer timer;
+};
+
+unsigned fetchJobs{1};
+unsigned searchJobs{1};
+#ifdef ARCH_HOST
+unsigned parseThreads{std::max(std::thread::hardware_concurrency(), 1U)};
+unsigned replayRate{10};
+unsigned replayPasses{1};
+unsigned replayPort{8000};
+#endif
+unsigned activeFetches;
+unsigned activeSearches;
+SearchJob* searches;
+Timer retryTimer;
+bool crawlComplete;
+CrawlStats stats;
+
 // These can be overridden via environment variables
 #define ENV_DEVICE_DIR "DEVICE_DIR"
 #define ENV_SCHEMA_DIR "SCHEMA_DIR"
@@ -108,15 +140,6 @@ void makedirs(const String& path)
 		*p++ = '/';
 	}
 }
-
-String& validate(String& path)
-{
-	path.replace(':', '-');
-	path.replace('?', '-');
-	path.replace('&', '-');
-	path.replace(' ', '_');
-	return path;
-}
 #endif
 
 Print* openStream(String path)
@@ -136,7 +159,7 @@ Print* openStream(String path)
 	return nullptr;
 }
 
-void writeSchema(XML::Node* object, const Urn& objectType)
+String getSchemaPath(const Urn& objectType)
 {
 	String path = schemaDir;
 	path += '/';
@@ -147,22 +170,33 @@ void writeSchema(XML::Node* object, const Urn& objectType)
 	path += objectType.type;
 	path += objectType.version;
 	path += ".xml";
+	return path;
+}
 
-	auto fs = openStream(path);
+void writeSchema(XML::Node* object, const Urn& objectType)
+{
+	auto fs = openStream(getSchemaPath(objectType));
 	if(fs != nullptr) {
 		XML::serialize(*object, *fs, true);
 		delete fs;
 	}
 }
 
-void writeServiceSchema(XML::Document& scpd, const String& serviceType, const String& serviceId)
+// Service schema include the type and ID from the parent device description
+void addServiceFields(XML::Document& scpd, const String& serviceType, const String& serviceId)
 {
 	XML::appendNode(scpd.first_node(), "serviceType", serviceType);
 	XML::appendNode(scpd.first_node(), "serviceId", serviceId);
+}
+
+void writeServiceSchema(XML::Document& scpd, const String& serviceType, const String& serviceId)
+{
+	addServiceFields(scpd, serviceType, serviceId);
 	writeSchema(&scpd, Urn(serviceType));
 }
 
-void writeDeviceSchema(XML::Node* device, const String& deviceType)
+// Device schema carry the namespace attributes from the document root
+void addRootAttributes(XML::Node* device)
 {
 	auto doc = device->document();
 	auto root = device->document()->first_node();
@@ -173,7 +207,11 @@ void writeDeviceSchema(XML::Node* device, const String& deviceType)
 		device->append_attribute(clone);
 		attr = attr->next_attribute();
 	}
+}
 
+void writeDeviceSchema(XML::Node* device, const String& deviceType)
+{
+	addRootAttributes(device);
 	writeSchema(device, Urn(deviceType));
 }
 
@@ -260,102 +298,198 @@ void parseDescription(XML::Document& description, const Fetch& f)
 	}
 }
 
-void scheduleFetch(unsigned delay)
+void onSsdp(SSDP::BasicMessage& msg);
+
+void onDescription(Fetch& f, HttpConnection& connection, XML::Document* description, size_t size)
 {
-	queueTimer.initializeMs(delay, fetchNextDescription).startOnce();
+#if DEBUG_VERBOSE_LEVEL == DBG
+	println();
+	println();
+	println(F("====== BEGIN ======"));
+	print(F("Remote IP: "));
+	print(connection.getRemoteIp().toString());
+	print(':');
+	println(connection.getRemotePort());
+
+	println(F("Request: "));
+	println(connection.getRequest()->toString());
+	println();
+
+	println(connection.getResponse()->toString());
+	println();
+
+	println(F("Content: "));
+	String content;
+	if(description == nullptr) {
+		content = connection.getResponse()->getBody();
+	} else {
+		content = XML::serialize(*description, true);
+	}
+	println(content);
+	println(F("======  END  ======"));
+#endif
+
+	--activeFetches;
+
+	auto response = connection.getResponse();
+	if(!response->isSuccess() || description == nullptr) {
+		if(f.attempts >= maxDescriptionFetchAttempts || response->code == HTTP_STATUS_NOT_FOUND) {
+			debug_e("Giving up on '%s' after %u attempts", f.toString().c_str(), f.attempts);
+			f.state = Fetch::State::failed;
+			++stats.failCount;
+		} else {
+			debug_w("Fetch '%s' failed, re-trying", f.url.c_str());
+			f.state = Fetch::State::pending;
+		}
+	} else {
+		stats.addFetch(millis() - f.startTime, size);
+
+		if(options[Option::writeDeviceTree]) {
+			// Write description
+			auto fs = openStream(f.fullPath());
+			if(fs != nullptr) {
+				XML::serialize(*description, *fs, true);
+				delete fs;
+			}
+		}
+
+		f.state = Fetch::State::success;
+
+		// Parsing queues more fetches, which may move `f`
+		Fetch fetch(f);
+		parseDescription(*description, fetch);
+	}
+
+	pump();
 }
 
-void fetchNextDescription()
+/*
+ * Description is buffered here rather than by the control point so the number of bytes received is known,
+ * which may differ from Content-Length or not be given at all for chunked responses
+ */
+void onFetchComplete(Fetch& f, HttpConnection& connection)
 {
-	Fetch* fetch{nullptr};
+	auto stream = connection.getResponse()->stream;
+	size_t size = (stream != nullptr) ? stream->available() : 0;
+
+	String content;
+	XML::Document description;
+	bool ok = stream != nullptr && stream->moveString(content) && XML::deserialize(description, content);
+	onDescription(f, connection, ok ? &description : nullptr, size);
+}
 
-	for(;;) {
+/*
+ * Start as many pending fetches as permitted
+ */
+void startFetches()
+{
+	while(activeFetches < fetchJobs) {
 		Fetch& f = descriptionQueue.find(Fetch::State::pending);
 		if(!f) {
-			beginNextSearch();
-			return;
+			break;
 		}
 
-		if(f.attempts < maxDescriptionFetchAttempts) {
-			++f.attempts;
-			debug_i("Fetching '%s', attempt #%u", f.toString().c_str(), f.attempts);
-			fetch = &f;
-			break;
+		if(f.attempts >= maxDescriptionFetchAttempts) {
+			debug_e("Giving up on '%s' after %u attempts", f.toString().c_str(), f.attempts);
+			f.state = Fetch::State::failed;
+			++stats.failCount;
+			continue;
 		}
-		debug_e("Giving up on '%s' after %u attempts", f.toString().c_str(), f.attempts);
-		f.state = Fetch::State::failed;
-	}
 
-	auto callback = [fetch](HttpConnection& connection, XML::Document* description) {
-#if DEBUG_VERBOSE_LEVEL == DBG
-		println();
-		println();
-		println(F("====== BEGIN ======"));
-		print(F("Remote IP: "));
-		print(connection.getRemoteIp().toString());
-		print(':');
-		println(connection.getRemotePort());
-
-		println(F("Request: "));
-		println(connection.getRequest()->toString());
-		println();
-
-		println(connection.getResponse()->toString());
-		println();
-
-		println(F("Content: "));
-		String content;
-		if(description == nullptr) {
-			content = connection.getResponse()->getBody();
-		} else {
-			content = XML::serialize(*description, true);
+		++f.attempts;
+		debug_i("Fetching '%s', attempt #%u", f.toString().c_str(), f.attempts);
+		// Queue storage may move as more work is added, so look the fetch up again on completion
+		auto sequence = f.sequence;
+		auto request = new HttpRequest(f.url);
+		request->setResponseStream(new MemoryDataStream);
+		request->onRequestComplete([sequence](HttpConnection& connection, bool success) -> int {
+			auto fetch = descriptionQueue.findSequence(sequence);
+			if(fetch == nullptr) {
+				debug_e("Fetch #%u not found", sequence);
+				--activeFetches;
+				pump();
+				return 0;
+			}
+			onFetchComplete(*fetch, connection);
+			return 0;
+		});
+		if(!controlPoint.sendRequest(request)) {
+			// Request queue is full, try again later
+			retryTimer.initializeMs<fetchRetryDelay>(pump).startOnce();
+			break;
 		}
-		println(content);
-		println(F("======  END  ======"));
-#endif
 
-		auto& f = *fetch;
+		f.state = Fetch::State::active;
+		f.startTime = millis();
+		++activeFetches;
+	}
+}
 
-		unsigned fetchDelay{fetchInterval};
+void onSearchComplete(SearchJob& job)
+{
+	job.controlPoint.cancelSearch();
+	--activeSearches;
+	pump();
+}
 
-		auto response = connection.getResponse();
-		if(!response->isSuccess()) {
-			// Fetch failed, move to end of queue
-			if(f.attempts >= maxDescriptionFetchAttempts || response->code == HTTP_STATUS_NOT_FOUND) {
-				debug_e("Giving up on '%s' after %u attempts", f.toString().c_str(), f.attempts);
-				f.state = Fetch::State::failed;
-			} else {
-				debug_w("Fetch '%s' failed, re-trying", f.url.c_str());
-				fetchDelay = fetchRetryDelay;
-			}
-		} else if(description != nullptr) {
-			if(options[Option::writeDeviceTree]) {
-				// Write description
-				auto fs = openStream(f.fullPath());
-				if(fs != nullptr) {
-					XML::serialize(*description, *fs, true);
-					delete fs;
-				}
-			}
+/*
+ * Start as many pending searches as permitted
+ */
+void startSearches()
+{
+	for(unsigned i = 0; i < searchJobs && activeSearches < searchJobs; ++i) {
+		auto& job = searches[i];
+		if(job.controlPoint.isSearchActive()) {
+			continue;
+		}
 
-			f.state = Fetch::State::success;
+		auto& f = ssdpQueue.find(Fetch::State::pending);
+		if(!bool(f)) {
+			break;
+		}
 
-			parseDescription(*description, f);
+		if(!job.controlPoint.beginSearch(f.urn(), onSsdp)) {
+			debug_w("Search for '%s' failed", f.toString().c_str());
+			f.state = Fetch::State::failed;
+			continue;
 		}
+		f.state = Fetch::State::success;
 
-		scheduleFetch(fetchDelay);
-	};
+		++stats.searchCount;
+		++activeSearches;
+		job.timer.initializeMs<searchDuration>([&job]() { onSearchComplete(job); }).startOnce();
+	}
+}
 
-	assert(fetch != nullptr);
+void printScanSummary();
 
-	unsigned fetchDelay;
-	if(controlPoint.requestDescription(fetch->url, callback)) {
-		fetchDelay = descriptionFetchTimeout;
-	} else {
-		fetchDelay = fetchRetryDelay;
+/*
+ * Called whenever a fetch or search completes, or new work is queued
+ */
+void pump()
+{
+	if(crawlComplete) {
+		return;
+	}
+
+	startFetches();
+	startSearches();
+
+	if(activeFetches != 0 || activeSearches != 0 || retryTimer.isStarted()) {
+		return;
 	}
 
-	scheduleFetch(fetchDelay);
+	crawlComplete = true;
+	println(F("ALL DONE"));
+	printScanSummary();
+	System.restart(2000);
+}
+
+void beginCrawl()
+{
+	searches = new SearchJob[searchJobs];
+	stats.begin();
+	pump();
 }
 
 Fetch createDescFetch(const String& location)
@@ -413,7 +547,7 @@ void onSsdp(SSDP::BasicMessage& msg)
 	auto& desc = descriptionQueue.add(f);
 	checkExisting(desc);
 
-	scheduleFetch(fetchInterval);
+	pump();
 }
 
 void printQueue(const FetchList& list)
@@ -429,21 +563,7 @@ void printScanSummary()
 {
 	printQueue(ssdpQueue);
 	printQueue(descriptionQueue);
-}
-
-void beginNextSearch()
-{
-	controlPoint.cancelSearch();
-	auto& f = ssdpQueue.find(Fetch::State::pending);
-	if(!bool(f)) {
-		println(F("ALL DONE"));
-		printScanSummary();
-		System.restart(2000);
-		return;
-	}
-
-	controlPoint.beginSearch(f.urn(), onSsdp);
-	f.state = Fetch::State::success;
+	println(stats.toString());
 }
 
 void scan(const Urn& urn)
@@ -460,7 +580,7 @@ void scan(const Urn& urn)
 		println(urn.toString());
 
 		ssdpQueue.add(urn);
-		beginNextSearch();
+		beginCrawl();
 
 		statusTimer.initializeMs<10000>(InterruptCallback([]() {
 			println();
@@ -468,6 +588,7 @@ void scan(const Urn& urn)
 			println(F("** Queue status **"));
 			println(descriptionQueue.toString());
 			println(ssdpQueue.toString());
+			println(stats.toString());
 			println(F("** ------------ **"));
 			println();
 			println();
@@ -513,6 +634,305 @@ void parseXml(String root, String filename)
 	}
 }
 
+/*
+ * Bulk parsing
+ *
+ * Device descriptions are located by searching each root directory, then parsed using a pool of threads.
+ * Service descriptions referenced by those devices are parsed in a second pass.
+ * Where several devices or services share the same type, the schema from the lowest-numbered job is used,
+ * so output does not depend on thread scheduling. Each schema is written as soon as it's parsed,
+ * and overwritten if a lower-numbered job produces the same type later, so only the job index
+ * for each schema path is kept in memory.
+ *
+ * Worker threads must not use the Sming debug output, which is not thread-safe.
+ */
+class BulkParser
+{
+public:
+	BulkParser(unsigned threadCount) : threadCount(threadCount)
+	{
+	}
+
+	void addRoot(String root);
+	void run();
+
+private:
+	struct Job {
+		String root;
+		String path; ///< Relative to root
+		String serviceType;
+		String serviceId;
+	};
+
+	using JobList = std::vector<Job>;
+
+	struct ServiceJob {
+		size_t jobIndex; ///< Device job which found the service
+		Job job;
+	};
+
+	void findFiles(const String& root, const String& dir);
+	void runJobs(const JobList& jobs, void (BulkParser::*process)(const Job&, size_t));
+	void parseDevice(const Job& job, size_t jobIndex);
+	void parseDeviceNode(XML::Node* device, const Job& job, size_t jobIndex);
+	void parseService(const Job& job, size_t jobIndex);
+	bool load(const String& path, String& content, XML::Document& doc);
+	void addServiceJob(size_t jobIndex, const Job& job);
+	void addSchema(const String& path, size_t jobIndex, const XML::Node& node);
+	bool writeSchema(const String& path, const String& content);
+
+	unsigned threadCount;
+	JobList deviceJobs;
+	JobList serviceJobs;
+	std::map<std::string, ServiceJob> pendingServices; ///< Service descriptions found, by path
+	std::map<std::string, size_t> schemaJobs;          ///< Job which wrote each schema, by path
+	std::mutex mutex;
+	std::atomic<unsigned> fileCount{0};
+	std::atomic<unsigned> schemaCount{0};
+	std::atomic<unsigned> errorCount{0};
+};
+
+void BulkParser::addRoot(String root)
+{
+	root.replace('\\', '/');
+	auto len = root.length();
+	if(len > 1 && root[len - 1] == '/') {
+		root.setLength(len - 1);
+	}
+
+	// Directory order varies between filesystems
+	auto start = deviceJobs.size();
+	findFiles(root, nullptr);
+	std::sort(deviceJobs.begin() + start, deviceJobs.end(),
+			  [](const Job& a, const Job& b) { return strcmp(a.path.c_str(), b.path.c_str()) < 0; });
+}
+
+void BulkParser::findFiles(const String& root, const String& dir)
+{
+	String dirPath = root + dir;
+	auto d = opendir(dirPath.c_str());
+	if(d == nullptr) {
+		m_printf("Cannot open directory '%s'\r\n", dirPath.c_str());
+		++errorCount;
+		return;
+	}
+
+	while(auto entry = readdir(d)) {
+		if(entry->d_name[0] == '.') {
+			continue;
+		}
+
+		String path = dir;
+		path += '/';
+		path += entry->d_name;
+
+		struct stat s;
+		if(::stat((root + path).c_str(), &s) < 0) {
+			continue;
+		}
+		if(S_ISDIR(s.st_mode)) {
+			findFiles(root, path);
+		} else if(path.endsWith(".xml")) {
+			deviceJobs.push_back({root, path, nullptr, nullptr});
+		}
+	}
+
+	closedir(d);
+}
+
+void BulkParser::runJobs(const JobList& jobs, void (BulkParser::*process)(const Job&, size_t))
+{
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		size_t i;
+		while((i = next++) < jobs.size()) {
+			(this->*process)(jobs[i], i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < threadCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	for(auto& t : threads) {
+		t.join();
+	}
+}
+
+bool BulkParser::load(const String& path, String& content, XML::Document& doc)
+{
+	auto f = fopen(path.c_str(), "rb");
+	if(f == nullptr) {
+		++errorCount;
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	auto size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	bool ok = size > 0 && content.setLength(size) && fread(content.begin(), 1, size, f) == size_t(size);
+	fclose(f);
+
+	ok = ok && XML::deserialize(doc, content);
+	if(!ok) {
+		++errorCount;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Several devices may refer to the same service description
+ */
+void BulkParser::addServiceJob(size_t jobIndex, const Job& job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string key = (job.root + job.path).c_str();
+	auto it = pendingServices.find(key);
+	if(it == pendingServices.end()) {
+		pendingServices.emplace(key, ServiceJob{jobIndex, job});
+	} else if(jobIndex < it->second.jobIndex) {
+		it->second = ServiceJob{jobIndex, job};
+	}
+}
+
+void BulkParser::addSchema(const String& path, size_t jobIndex, const XML::Node& node)
+{
+	std::string key = path.c_str();
+	auto isPreferred = [&]() {
+		auto it = schemaJobs.find(key);
+		return it == schemaJobs.end() || jobIndex < it->second;
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!isPreferred()) {
+			return;
+		}
+	}
+
+	// Serialize outside lock, then check again in case another job got there first
+	String content = XML::serialize(node, true);
+
+	/*
+	 * Write whilst holding the lock, otherwise a slower write from a higher-numbered job
+	 * could finish last and leave the wrong content in the file
+	 */
+	std::lock_guard<std::mutex> lock(mutex);
+	if(!isPreferred()) {
+		return;
+	}
+	bool isNew = schemaJobs.find(key) == schemaJobs.end();
+	if(!writeSchema(path, content)) {
+		return;
+	}
+	schemaJobs[key] = jobIndex;
+	if(isNew) {
+		++schemaCount;
+	}
+}
+
+bool BulkParser::writeSchema(const String& path, const String& content)
+{
+	String filename = path;
+	validate(filename);
+	makedirs(filename);
+	auto f = fopen(filename.c_str(), "wb");
+	if(f == nullptr) {
+		++errorCount;
+		return false;
+	}
+	fwrite(content.c_str(), 1, content.length(), f);
+	fclose(f);
+	return true;
+}
+
+void BulkParser::parseDevice(const Job& job, size_t jobIndex)
+{
+	String content;
+	XML::Document doc;
+	if(!load(job.root + job.path, content, doc)) {
+		return;
+	}
+
+	// Service descriptions are found in the same directories, and handled in the second pass
+	if(doc.first_node("root") == nullptr) {
+		return;
+	}
+	++fileCount;
+
+	auto device = XML::getNode(doc, "/device");
+	if(device != nullptr) {
+		parseDeviceNode(device, job, jobIndex);
+	}
+}
+
+void BulkParser::parseDeviceNode(XML::Node* device, const Job& job, size_t jobIndex)
+{
+	String deviceType = XML::getValue(device, "deviceType");
+	if(!deviceType) {
+		++errorCount;
+		return;
+	}
+
+	auto serviceList = device->first_node("serviceList");
+	for(auto svc = serviceList ? serviceList->first_node() : nullptr; svc != nullptr; svc = svc->next_sibling()) {
+		String serviceType = XML::getValue(svc, "serviceType");
+		String path = XML::getValue(svc, "SCPDURL");
+		if(!serviceType || !path) {
+			++errorCount;
+			continue;
+		}
+		if(path.indexOf("://") > 0) {
+			path = Url(path).Path;
+		}
+		if(path[0] != '/') {
+			path = '/' + path;
+		}
+		addServiceJob(jobIndex, {job.root, path, serviceType, XML::getValue(svc, "serviceId")});
+	}
+
+	addRootAttributes(device);
+	addSchema(getSchemaPath(Urn(deviceType)), jobIndex, *device);
+
+	auto deviceList = device->first_node("deviceList");
+	for(auto dev = deviceList ? deviceList->first_node() : nullptr; dev != nullptr; dev = dev->next_sibling()) {
+		parseDeviceNode(dev, job, jobIndex);
+	}
+}
+
+void BulkParser::parseService(const Job& job, size_t jobIndex)
+{
+	String content;
+	XML::Document doc;
+	if(!load(job.root + job.path, content, doc) || doc.first_node() == nullptr) {
+		return;
+	}
+	++fileCount;
+
+	addServiceFields(doc, job.serviceType, job.serviceId);
+	addSchema(getSchemaPath(Urn(job.serviceType)), jobIndex, doc);
+}
+
+void BulkParser::run()
+{
+	m_printf("Parsing %u files using %u threads\r\n", unsigned(deviceJobs.size()), threadCount);
+
+	auto startTime = std::chrono::steady_clock::now();
+	runJobs(deviceJobs, &BulkParser::parseDevice);
+
+	for(auto& entry : pendingServices) {
+		serviceJobs.push_back(entry.second.job);
+	}
+	pendingServices.clear();
+	runJobs(serviceJobs, &BulkParser::parseService);
+	schemaJobs.clear();
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	m_printf("Parsed %u files, wrote %u schema, %u errors in %.3f seconds (%.1f files/s)\r\n", fileCount.load(),
+			 schemaCount.load(), errorCount.load(), elapsed, elapsed > 0 ? fileCount / elapsed : 0.0);
+}
+
 void help()
 {
 	println();
@@ -520,25 +940,67 @@ void help()
 	println(F("  scan   urn                Perform a local network scan (default is upnp:rootdevice)"));
 	println(F("  fetch  URL(s)...          Fetch descriptions"));
 	println(F("  parse  root filenames...  Parse XML files from given root directory"));
+	println(F("  bulkparse  root(s)...     Generate schema from all descriptions in given root directories"));
+	println(F("  replay root(s)...         Replay captured root device discovery from scan output directories"));
+	println();
+	println(F("Scan and fetch options:"));
+	println(F("  --jobs=N                  Number of descriptions to fetch concurrently (default 1)"));
+	println(F("  --searches=N              Number of concurrent searches (default 1)"));
+	println();
+	println(F("Bulkparse options:"));
+	println(F("  --threads=N               Number of parser threads (default is number of CPUs)"));
+	println();
+	println(F("Replay options:"));
+	println(F("  --rate=N                  SSDP messages per second (default 10)"));
+	println(F("  --passes=N                Number of times to replay capture (default 1)"));
+	println(F("  --port=N                  Local HTTP server port (default 8000)"));
 	println();
 }
 
+/*
+ * Parse option of the form `--name=N`
+ * Return false if parameter isn't a recognised option.
+ */
+bool parseOption(const String& param)
+{
+	auto getValue = [&](const char* name, unsigned& value, unsigned maxValue = maxJobs) -> bool {
+		auto len = strlen(name);
+		if(!param.startsWith(name) || param[len] != '=') {
+			return false;
+		}
+		value = constrain(atoi(param.c_str() + len + 1), 1, int(maxValue));
+		return true;
+	};
+
+	return getValue("--jobs", fetchJobs) || getValue("--searches", searchJobs) || getValue("--threads", parseThreads) ||
+		   getValue("--rate", replayRate, 100000) || getValue("--passes", replayPasses, 1000) ||
+		   getValue("--port", replayPort, 65535);
+}
+
 /*
  * Return true to continue execution, false to quit.
  */
 bool parseCommands()
 {
-	auto parameters = commandLine.getParameters();
+	auto allParameters = commandLine.getParameters();
+	Vector<const char*> parameters;
+	for(unsigned i = 0; i < allParameters.count(); ++i) {
+		auto text = allParameters[i].text;
+		if(!parseOption(text)) {
+			parameters.add(text);
+		}
+	}
+
 	if(parameters.count() == 0) {
 		help();
 		return false;
 	}
 
-	String cmd = parameters[0].text;
+	String cmd = parameters[0];
 	if(cmd == "scan") {
 		auto urn = RootDeviceUrn();
 		if(parameters.count() > 1) {
-			auto str = parameters[1].text;
+			auto str = parameters[1];
 			if(!urn.decompose(str)) {
 				m_printf("Invalid URN: %s\n", str);
 				return false;
@@ -555,10 +1017,47 @@ bool parseCommands()
 		}
 
 		for(unsigned i = 1; i < parameters.count(); ++i) {
-			descriptionQueue.add(createDescFetch(parameters[i].text));
+			descriptionQueue.add(createDescFetch(parameters[i]));
+		}
+
+		beginCrawl();
+		return true;
+	}
+
+	if(cmd == "bulkparse") {
+		if(parameters.count() < 2) {
+			println(F("** Missing parameters"));
+			help();
+		} else {
+			BulkParser parser(parseThreads);
+			for(unsigned i = 1; i < parameters.count(); ++i) {
+				parser.addRoot(parameters[i]);
+			}
+			parser.run();
+		}
+		return false;
+	}
+
+	if(cmd == "replay") {
+		if(parameters.count() < 2) {
+			println(F("** Missing parameters"));
+			help();
+			return false;
+		}
+
+		static Replay replay(controlPoint);
+		unsigned count{0};
+		for(unsigned i = 1; i < parameters.count(); ++i) {
+			count += replay.addCapture(parameters[i], RootDeviceUrn());
+		}
+		if(count == 0) {
+			println(F("** No messages found"));
+			return false;
 		}
 
-		scheduleFetch(fetchInterval);
+		WifiEvents.onStationGotIP([](IpAddress ip, IpAddress netmask, IpAddress gateway) {
+			replay.begin(replayPort, replayRate, replayPasses);
+		});
 		return true;
 	}
 
@@ -567,9 +1066,9 @@ bool parseCommands()
 			println(F("** Missing parameters"));
 			help();
 		} else {
-			String root = parameters[1].text;
+			String root = parameters[1];
 			for(unsigned i = 2; i < parameters.count(); ++i) {
-				parseXml(root, parameters[i].text);
+				parseXml(root, parameters[i]);
 			}
 			printQueue(descriptionQueue);
 		}